@@ -0,0 +1,227 @@
+#ifndef __ARASTAR__
+#define __ARASTAR__
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+
+#include "astar.hpp"
+#include "node_arena.hpp"
+#include "closed_table.hpp"
+#include "open_list.hpp"
+#include "zobrist.hpp"
+
+//  Anytime repairing A* (ARA*): a series of weighted A* searches, the heuristic multiplied
+//  by a weight lowered by weight_step after every search, down to 1.
+//
+//  Every search stops as soon as no front node has a lower weighted total cost than
+//  the best solution so far, so the first solution comes quickly at a high weight.
+//  The open and closed sets are kept between the searches: the nodes which got cheaper
+//  after having been expanded in the current search are not expanded again, but put aside
+//  as inconsistent, to be expanded by the next search (with the front reordered by the new
+//  weight), except by the last one, with the weight of 1, which is plain A*.
+//  For an admissible heuristic, the solution cost is within bound() times the optimal one,
+//  bound() being 1 once the solution is proven optimal.
+template <typename TProblem, typename TPos = typename TProblem::position,
+    typename TMove = typename TProblem::move, typename TQueuePolicy = bucket_queue_policy<>>
+class arastar {
+public:
+    arastar(const TProblem& problem, const TPos& source, float weight = 3.0f, float weight_step = 0.5f) :
+        _problem(problem), _source(source), _has_solution(false), _done(false),
+        _weight(std::max(weight, 1.0f)), _weight_step(weight_step), _bound(INF),
+        _best_cost(INF), _iteration(0), _num_expanded(0) {
+        const uint32_t k = closed_table::key(position_hash(_source));
+        _visited.find(k, [](uint32_t) { return false; });
+        const uint32_t idx0 = _nodes.allocate();
+        node* pn0 = &_nodes[idx0];
+        *pn0 = { _source, TMove(), 0.0f, _problem.estimate_cost(_source), 0.0f, true, false, 0 };
+        pn0->weighted_to_dst = _weight*pn0->cost_to_dst;
+        _front.push(pn0);
+        _visited.insert(k, idx0);
+        if (_problem.is_target(_source)) update_solution(_source, 0.0f);
+    }
+
+    //  runs the search with the current weight (lowering it first if it's not the first one),
+    //  returns false once there is nothing to improve (or no solution)
+    bool improve() {
+        if (_done) return false;
+        if (_iteration > 0) {
+            _weight = std::max(1.0f, _weight - _weight_step);
+            reorder_front();
+        }
+        _iteration++;
+
+        while (true) {
+            node* pn0 = _front.top();
+            if (pn0 == nullptr || pn0->total_cost() >= _best_cost) break;
+            _front.pop();
+            pn0->in_front = false;
+            pn0->closed = _iteration;
+            expand(pn0);
+        }
+
+        //  the lowest unweighted total cost of the nodes left to expand bounds the optimal cost,
+        //  for any admissible heuristic (while the weight bounds it for the consistent ones only)
+        float min_cost = INF;
+        const uint32_t nnodes = _nodes.size();
+        for (uint32_t i = 0; i < nnodes; i++) {
+            const node& n = _nodes[i];
+            if (n.in_front || n.incons) min_cost = std::min(min_cost, n.cost_from_src + n.cost_to_dst);
+        }
+        if (_has_solution) {
+            _bound = (min_cost >= _best_cost) ? 1.0f : _best_cost/std::max(min_cost, 1e-6f);
+        }
+        _done = (min_cost == INF) || (min_cost >= _best_cost);
+        return true;
+    }
+
+    void solve() {
+        while (improve()) {
+        }
+    }
+
+    bool get_solution(std::vector<TMove>& res) const {
+        if (!_has_solution) return false;
+        res.clear();
+        TPos pos = _found_target;
+        while (!(pos == _source)) {
+            const uint32_t idx = find_node(closed_table::key(position_hash(pos)), pos);
+            if (idx == closed_table::NONE) {
+                return false;
+            }
+            const node* pn = &_nodes[idx];
+            _problem.unapply_move(pn->pos, pn->move, pos);
+            res.push_back(pn->move);
+        }
+        std::reverse(res.begin(), res.end());
+        resolve_moves(_problem, _source, res, 0);
+        return true;
+    }
+
+    bool has_solution() const { return _has_solution; }
+    //  whether the solution can't be improved any further (or there is none)
+    bool done() const { return _done; }
+    float solution_cost() const { return _best_cost; }
+    //  weight of the last search
+    float weight() const { return _weight; }
+    //  suboptimality bound of the solution found
+    float bound() const { return _bound; }
+
+    uint32_t num_visited() const { return _visited.size(); }
+    uint64_t num_expanded() const { return _num_expanded; }
+
+private:
+    static constexpr float INF = std::numeric_limits<float>::max();
+
+    struct node {
+        TPos        pos;                //  node's position
+        TMove       move;               //  move that lead to this pos
+        float       cost_from_src;      //  cost from source node (real one)
+        float       cost_to_dst;        //  heuristically estimated cost to target node
+        float       weighted_to_dst;    //  the estimate times the current weight
+        bool        in_front;           //  whether this node is still in the front queue
+        bool        incons;             //  whether the node got cheaper after its expansion
+        uint32_t    closed;             //  search iteration the node was expanded in, if any
+
+        inline float total_cost() const {
+            return cost_from_src + weighted_to_dst;
+        }
+    };
+
+    typedef typename TQueuePolicy::template queue<node> node_queue;
+
+    const TProblem&     _problem;       //  reference to the problem
+    TPos                _source;        //  starting position
+    TPos                _found_target;  //  the best target position found
+    bool                _has_solution;  //  whether a solution has been found
+    bool                _done;          //  whether the search is over
+
+    float               _weight;        //  heuristic weight of the current search
+    float               _weight_step;   //  weight decrement between the searches
+    float               _bound;         //  suboptimality bound of the solution
+    float               _best_cost;     //  cost of the solution
+    uint32_t            _iteration;     //  current search, starting from 1
+    uint64_t            _num_expanded;
+
+    std::vector<TMove>  _moves;         //  moves container (transient)
+    TPos                _succ;          //  successor position (transient)
+
+    node_queue          _front;         //  front node queue
+    closed_table        _visited;       //  visited node registry, indices into _nodes
+    node_arena<node>    _nodes;         //  node storage
+
+    inline uint32_t find_node(uint32_t k, const TPos& pos) const {
+        return _visited.find(k, [&](uint32_t idx) { return _nodes[idx].pos == pos; });
+    }
+
+    void update_solution(const TPos& pos, float cost) {
+        if (cost < _best_cost) {
+            _best_cost = cost;
+            _found_target = pos;
+            _has_solution = true;
+        }
+    }
+
+    void expand(node* pn0) {
+        _num_expanded++;
+        _moves.clear();
+        _problem.get_moves(pn0->pos, _moves);
+        for (const auto& move : _moves) {
+            _problem.apply_move(pn0->pos, move, _succ);
+            const float cost_from_src = pn0->cost_from_src + _problem.get_cost(pn0->pos, move);
+
+            const uint32_t k = closed_table::key(position_hash(_succ));
+            const uint32_t idx = find_node(k, _succ);
+            if (idx == closed_table::NONE) {
+                const uint32_t idx_new = _nodes.allocate();
+                node* pnew = &_nodes[idx_new];
+                pnew->pos               = _succ;
+                pnew->move              = move;
+                pnew->cost_from_src     = cost_from_src;
+                pnew->cost_to_dst       = _problem.estimate_cost(_succ);
+                pnew->weighted_to_dst   = _weight*pnew->cost_to_dst;
+                pnew->in_front          = true;
+                pnew->incons            = false;
+                pnew->closed            = 0;
+                _front.push(pnew);
+                _visited.insert(k, idx_new);
+                if (_problem.is_target(_succ)) update_solution(_succ, cost_from_src);
+                continue;
+            }
+
+            node* pn = &_nodes[idx];
+            if (pn->cost_from_src <= cost_from_src) continue;
+            if (pn->in_front) _front.erase(pn);
+            pn->cost_from_src   = cost_from_src;
+            pn->move            = move;
+            if (_problem.is_target(_succ)) update_solution(_succ, cost_from_src);
+            if (pn->closed == _iteration && _weight > 1.0f) {
+                //  already expanded by this search, left for the next one
+                //  (the last one, with the weight of 1, reopens the node as A* does)
+                pn->incons = true;
+            } else {
+                //  may have been expanded by a previous search, with another weight
+                pn->weighted_to_dst = _weight*pn->cost_to_dst;
+                pn->in_front        = true;
+                _front.push(pn);
+            }
+        }
+    }
+
+    //  the front with the inconsistent nodes added, ordered by the current weight
+    void reorder_front() {
+        _front = node_queue();
+        const uint32_t nnodes = _nodes.size();
+        for (uint32_t i = 0; i < nnodes; i++) {
+            node* pn = &_nodes[i];
+            if (!pn->in_front && !pn->incons) continue;
+            pn->in_front        = true;
+            pn->incons          = false;
+            pn->weighted_to_dst = _weight*pn->cost_to_dst;
+            _front.push(pn);
+        }
+    }
+};
+
+#endif // __ARASTAR__
@@ -2,84 +2,223 @@
 #define __ASTAR__
 
 #include <vector>
-#include <set>
-#include <unordered_set>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <type_traits>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
 
-#include "pool_alloc.hpp"
+#include "node_arena.hpp"
+#include "closed_table.hpp"
+#include "open_list.hpp"
+#include "zobrist.hpp"
+#include "search_observer.hpp"
 
-template <typename TProblem, typename TPos = TProblem::position, typename TMove = TProblem::move>
+//  lets the problem post-process the found moves, if it has resolve_moves(source, moves)
+template <typename TProblem, typename TPos, typename TMove>
+auto resolve_moves(const TProblem& problem, const TPos& source, std::vector<TMove>& moves, int) ->
+    decltype(problem.resolve_moves(source, moves), void()) {
+    problem.resolve_moves(source, moves);
+}
+
+template <typename TProblem, typename TPos, typename TMove>
+void resolve_moves(const TProblem&, const TPos&, std::vector<TMove>&, long) {}
+
+//  lets the problem end the search at a position it knows the rest of the solution from, 
+//  if it has known_solution(pos, moves) (the moves from the position to the target)
+template <typename TProblem, typename TPos, typename TMove>
+auto known_solution(const TProblem& problem, const TPos& pos, std::vector<TMove>& moves, int) ->
+    decltype(problem.known_solution(pos, moves)) {
+    return problem.known_solution(pos, moves);
+}
+
+template <typename TProblem, typename TPos, typename TMove>
+bool known_solution(const TProblem&, const TPos&, std::vector<TMove>&, long) {
+    return false;
+}
+
+//  lets the problem keep the positions of the stored nodes packed into 64 bits, if it has
+//  pack_position(pos, packed) (false if its positions don't fit, for all of them) and
+//  unpack_position(packed, pos)
+template <typename TProblem, typename TPos>
+auto pack_position(const TProblem& problem, const TPos& pos, uint64_t& res, int) ->
+    decltype(problem.pack_position(pos, res)) {
+    return problem.pack_position(pos, res);
+}
+
+template <typename TProblem, typename TPos>
+bool pack_position(const TProblem&, const TPos&, uint64_t&, long) {
+    return false;
+}
+
+template <typename TProblem, typename TPos>
+auto unpack_position(const TProblem& problem, uint64_t packed, TPos& res, int) ->
+    decltype(problem.unpack_position(packed, res), void()) {
+    problem.unpack_position(packed, res);
+}
+
+template <typename TProblem, typename TPos>
+void unpack_position(const TProblem&, uint64_t, TPos&, long) {}
+
+//  identifies the problem in the checkpoints, if it has board_key() (0 if it does not);
+//  the source position is checked along with it
+template <typename TProblem>
+auto problem_key(const TProblem& problem, int) -> decltype((uint64_t)problem.board_key()) {
+    return problem.board_key();
+}
+
+template <typename TProblem>
+uint64_t problem_key(const TProblem&, long) {
+    return 0;
+}
+
+//  identifies the heuristic configuration in the checkpoints, if the problem has heuristic_key() 
+//  (0 if it does not), as the nodes keep the cost estimates of the search which saved them
+template <typename TProblem>
+auto heuristic_key(const TProblem& problem, int) -> decltype((uint64_t)problem.heuristic_key()) {
+    return problem.heuristic_key();
+}
+
+template <typename TProblem>
+uint64_t heuristic_key(const TProblem&, long) {
+    return 0;
+}
+
+//  lets the problem estimate the costs of many positions at once (for the batched expansion), 
+//  if it has estimate_costs(positions, n, costs)
+template <typename TProblem, typename TPos>
+auto estimate_costs(const TProblem& problem, const TPos* pos, size_t n, float* res, int) ->
+    decltype(problem.estimate_costs(pos, n, res), void()) {
+    problem.estimate_costs(pos, n, res);
+}
+
+template <typename TProblem, typename TPos>
+void estimate_costs(const TProblem& problem, const TPos* pos, size_t n, float* res, long) {
+    for (size_t i = 0; i < n; i++) res[i] = problem.estimate_cost(pos[i]);
+}
+
+//  costs kept by the search nodes: 16-bit fixed point if the problem has 
+//  static constexpr int cost_scale (its move costs and estimates being the multiples 
+//  of 1/cost_scale, rounded to them otherwise), floats if it does not
+template <typename TProblem, typename = void>
+struct node_cost {
+    typedef float type;
+
+    static inline float from_float(float c) { return c; }
+    static inline float to_float(float c) { return c; }
+};
+
+template <typename TProblem>
+struct node_cost<TProblem, decltype((void)TProblem::cost_scale)> {
+    typedef uint16_t type;
+
+    static inline uint16_t from_float(float c) {
+        assert(c >= 0.0f && c*TProblem::cost_scale < 65535.5f);
+        return (uint16_t)(c*TProblem::cost_scale + 0.5f);
+    }
+
+    static inline float to_float(int c) { return (float)c/TProblem::cost_scale; }
+};
+
+//  budget of a solve() call, zero meaning no limit
+struct search_limits {
+    uint64_t    max_expansions  = 0;    //  number of the positions expanded by the call
+    double      max_seconds     = 0.0;  //  wall time of the call
+    uint64_t    max_bytes       = 0;    //  memory taken by the search
+};
+
+enum class search_status {
+    solved,             //  found the solution
+    no_solution,        //  the search space is exhausted
+    expansion_limit,    //  out of the budget, the search can be continued
+    time_limit,
+    memory_limit
+};
+
+//  TObserver gets notified about the search events (see search_observer.hpp),
+//  the default null_observer costs nothing.
+//
+//  The nodes are stored column-wise, addressed by their 32-bit indices: the costs and 
+//  the front flag the queue reads (hot), and the position, the parent node and the move 
+//  from it (cold), the position packed if the problem can pack it. The path is rebuilt 
+//  by following the parents
+template <typename TProblem, typename TPos = typename TProblem::position,
+    typename TMove = typename TProblem::move, typename TQueuePolicy = bucket_queue_policy<>,
+    typename TObserver = null_observer>
 class astar {
 public:
     astar(const TProblem& problem, const TPos& source) :
-        _problem(problem), _source(source), _has_solution(false){
-        node* pn0 = _pool.allocate();
-        *pn0 = { _source, TMove(), 0.0f, 0.0f, true };
-        _front.insert(pn0);
-        _visited.insert(pn0);
-    }
-
-    ~astar() {
-        for (node* n : _visited) _pool.free(n);
+        _problem(problem), _source(source), _has_solution(false), _target_node(closed_table::NONE), 
+        _num_expanded(0), _batch_size(1), _front(node_access(&_costs)), _packed(false) {
+        uint64_t packed = 0;
+        _packed = pack_position(_problem, _source, packed, 0);
+        const uint32_t k = closed_table::key(position_hash(_source));
+        _visited.find(k, [](uint32_t) { return false; });
+        const uint32_t idx0 = add_node(_source, packed, closed_table::NONE, TMove(), 0, 0);
+        _front.push(idx0);
+        _visited.insert(k, idx0);
     }
 
     bool step() {
-        node* pn0 = *(_front.begin());
-        _front.erase(pn0);
-        pn0->in_front = false;
-
-        if (_problem.is_target(pn0->pos)) {
-            //  found the target node, done
-            _found_target = pn0->pos;
-            _has_solution = true;
+        if (_batch_size > 1) return step_batch(_batch_size);
+        uint32_t idx0;
+        {
+            typename TObserver::timer t(_observer, search_phase::queue);
+            idx0 = _front.pop();
+        }
+        if (idx0 == closed_table::NONE) {
+            //  only stale entries were left in the front queue, no solution
             return true;
         }
+        node* pn0 = &_costs[idx0];
+        pn0->in_front = false;
+        const TPos& pos0 = get_position(idx0, _pos);
+        if (reached_target(idx0, pos0)) return true;
 
         //  expand possible moves from this node
+        _num_expanded++;
+        if (TObserver::enabled) _observer.on_expand(pn0->total_cost(), cost_traits::to_float(pn0->cost_from_src));
         _moves.clear();
-        _problem.get_moves(pn0->pos, _moves);
+        {
+            typename TObserver::timer t(_observer, search_phase::moves);
+            _problem.get_moves(pos0, _moves);
+        }
 
         for (const auto& move : _moves) {
-            node* pnew = _pool.allocate();
-            _problem.apply_move(pn0->pos, move, pnew->pos);
+            //  probe the visited registry before allocating anything or estimating the cost,
+            //  which is only done once per position, for the new ones
+            _problem.apply_move(pos0, move, _succ);
+            const cost_type cost_from_src = (cost_type)(pn0->cost_from_src + 
+                cost_traits::from_float(_problem.get_cost(pos0, move)));
+            if (TObserver::enabled) _observer.on_generate();
 
-            pnew->cost_from_src  = pn0->cost_from_src + _problem.get_cost(pn0->pos, move);
-            pnew->move           = move;
-            pnew->in_front       = true;
-
-            auto it = _visited.find(pnew);
-            if (it == _visited.end()) {
+            uint32_t k, idx;
+            uint64_t packed = 0;
+            {
+                typename TObserver::timer t(_observer, search_phase::hashing);
+                if (_packed) pack_position(_problem, _succ, packed, 0);
+                k = closed_table::key(position_hash(_succ));
+                idx = find_node(k, _succ, packed);
+            }
+            if (idx == closed_table::NONE) {
                 //  a completely new node 
-                pnew->cost_to_dst = _problem.estimate_cost(pnew->pos);
-                _front.insert(pnew);
-                _visited.insert(pnew);
+                const uint32_t idx_new = add_node(_succ, packed, idx0, move, cost_from_src, estimate_cost(_succ));
+                {
+                    typename TObserver::timer t(_observer, search_phase::queue);
+                    _front.push(idx_new);
+                }
+                _visited.insert(k, idx_new);
                 continue;
             } 
             
-            node* pn = *it;
-            if (pn->in_front) {
-                //  the node is already in the front queue
-                if (pn->cost_from_src > pnew->cost_from_src) {
-                    //  the new node is better, replace the old one in the front queue
-                    _front.erase(pn);
-                    pn->cost_from_src   = pnew->cost_from_src;
-                    pn->cost_to_dst     = _problem.estimate_cost(pnew->pos);
-                    pn->move            = move;
-                    _front.insert(pn);
-                }
-            } else {
-                //  the node had been already visited
-                if (pn->cost_from_src > pnew->cost_from_src) {
-                    //  found a better node, update the path/cost 
-                    pn->cost_from_src   = pnew->cost_from_src;
-                    pn->cost_to_dst     = _problem.estimate_cost(pnew->pos);
-                    pn->move            = move;
-                }
-            }
-            _pool.free(pnew);
+            if (TObserver::enabled) _observer.on_duplicate();
+            update_node(idx, idx0, move, cost_from_src);
         }
 
-        return (_front.size() == 0);
+        if (TObserver::enabled) _observer.on_progress(_front.size(), _visited.size(), bytes());
+        return _front.empty();
     }
 
     void solve() {
@@ -87,75 +226,451 @@ public:
         }
     }
 
+    //  runs the search until done or out of the budget, can be called again to continue
+    search_status solve(const search_limits& limits) {
+        using namespace std::chrono;
+        const auto start = steady_clock::now();
+        const uint64_t start_expanded = _num_expanded;
+        for (uint64_t n = 0; !_has_solution; n++) {
+            const uint64_t expanded = _num_expanded - start_expanded;
+            if (limits.max_expansions > 0 && expanded >= limits.max_expansions) {
+                return search_status::expansion_limit;
+            }
+            if ((n & (CHECK_PERIOD - 1)) == 0) {
+                if (limits.max_seconds > 0.0 && 
+                    duration<double>(steady_clock::now() - start).count() >= limits.max_seconds) {
+                    return search_status::time_limit;
+                }
+                if (limits.max_bytes > 0 && bytes() >= limits.max_bytes) {
+                    return search_status::memory_limit;
+                }
+            }
+            //  the last batch is cut to the budget left
+            const bool done = _batch_size > 1 ? step_batch(limits.max_expansions > 0 ? 
+                (uint32_t)std::min<uint64_t>(_batch_size, limits.max_expansions - expanded) : _batch_size) : step();
+            if (done) break;
+        }
+        return _has_solution ? search_status::solved : search_status::no_solution;
+    }
+
     bool get_solution(std::vector<TMove>& res) const {
         if (!_has_solution) return false;
         res.clear();
-        node n{ _found_target };
-        while (true) {
-            auto& it = _visited.find(&n);
-            if (it == _visited.end()) {
-                return false;
-            }
-            const node* pn = *it;
-            _problem.unapply_move(pn->pos, pn->move, n.pos);
-            res.push_back(pn->move);
-            if (n.pos == _source) {
-                break;
-            }
+        for (uint32_t idx = _target_node; _parents[idx] != closed_table::NONE; idx = _parents[idx]) {
+            res.push_back(_node_moves[idx]);
         }
         std::reverse(res.begin(), res.end());
+        res.insert(res.end(), _known_moves.begin(), _known_moves.end());
+        resolve_moves(_problem, _source, res, 0);
         return true;
     }
 
+    //  number of the front nodes of the same total cost expanded by a step (1 by default):
+    //  the successors of all of them are generated first, then the visited registry is probed
+    //  for them (prefetched) and the new ones get their costs estimated in bulk (with 
+    //  estimate_costs() if the problem has it, otherwise there is little to gain). The nodes of 
+    //  equal cost are taken in the queue order, so the search may expand a few more of them 
+    //  than one by one
+    void set_batch_size(uint32_t size) { _batch_size = std::max(size, 1u); }
+    uint32_t batch_size() const { return _batch_size; }
+
+    bool has_solution() const { return _has_solution; }
+    TObserver& observer() { return _observer; }
+    const TObserver& observer() const { return _observer; }
+    uint64_t num_expanded() const { return _num_expanded; }
+
+    //  memory taken by the nodes, the visited registry and the front queue, bytes
+    uint64_t bytes() const { 
+        return _costs.bytes() + _parents.bytes() + _node_moves.bytes() + _positions.bytes() + 
+            _packed_positions.bytes() + _visited.bytes() + (uint64_t)_front.size()*sizeof(uint32_t);
+    }
+
+    //  memory taken by a node (all its columns), bytes
+    size_t node_bytes() const {
+        return sizeof(node) + sizeof(uint32_t) + sizeof(TMove) + (_packed ? sizeof(uint64_t) : sizeof(TPos));
+    }
+
+    //  whether the positions of the nodes are stored packed
+    bool packed_positions() const { return _packed; }
+
+    //  saves the nodes to be loaded by a search of the same problem later on, 
+    //  the front queue and the visited registry are rebuilt from them.
+    //  Fails if the positions or the moves aren't trivially copyable
+    bool save(const std::string& path) const {
+        return save(path, is_copyable());
+    }
+
+    //  replaces the search state with the saved one of the same problem, heuristic and source; 
+    //  a file of another one is rejected keeping the state, the search is not usable if reading fails after
+    bool load(const std::string& path) {
+        return load(path, is_copyable());
+    }
+
+    //  visited registry statistics
+    uint32_t num_visited() const { return _visited.size(); }
+    float visited_load_factor() const { return _visited.load_factor(); }
+    const closed_table::stats& visited_stats() const { return _visited.get_stats(); }
+
 private:
+    typedef node_cost<TProblem> cost_traits;
+    typedef typename cost_traits::type cost_type;
+
+    //  the hot part of a node, the rest is in the other columns of the same index
     struct node {
-        TPos    pos;            //  node's position
-        TMove   move;           //  move that lead to this pos
-        float   cost_from_src;  //  cost from source node (real one)
-        float   cost_to_dst;    //  heuristically estimated cost to target node
-        bool    in_front;       //  whether this node is still in the front queue
+        cost_type   cost_from_src;  //  cost from source node (real one)
+        cost_type   cost_to_dst;    //  heuristically estimated cost to target node
+        bool        in_front;       //  whether this node is still in the front queue
 
         inline float total_cost() const {
-            return cost_from_src + cost_to_dst;
+            return cost_traits::to_float(cost_from_src + cost_to_dst);
         }
+    };
 
-        struct hash {
-            std::size_t operator() (const node* node) const {
-                return node->pos();
-            }
-        };
-        
-        struct less {
-            bool operator() (const node* nl, const node* nr) const {
-                const float costl = nl->total_cost();
-                const float costr = nr->total_cost();
-                return (costl == costr) ? (nl < nr) : (costl < costr);
-            }
-        };
+    //  the front queue entries are the node indices
+    struct node_access {
+        typedef uint32_t ref;
 
-        struct eq {
-            bool operator() (const node* lhs, const node* rhs) const {
-                return lhs->pos == rhs->pos;
-            }
-        };
+        const node_arena<node>* nodes;
+
+        explicit node_access(const node_arena<node>* n = nullptr) : nodes(n) {}
+
+        static uint32_t null() { return closed_table::NONE; }
+        float total_cost(uint32_t idx) const { return (*nodes)[idx].total_cost(); }
+        float cost_from_src(uint32_t idx) const { return cost_traits::to_float((*nodes)[idx].cost_from_src); }
+        bool in_front(uint32_t idx) const { return (*nodes)[idx].in_front; }
     };
 
-    typedef std::set<node*, typename node::less> node_queue;
-    typedef std::unordered_set<node*, typename node::hash, typename node::eq> node_set;
-    typedef pool_alloc<node> node_pool;
+    typedef typename TQueuePolicy::template queue<node, node_access> node_queue;
     typedef std::vector<TMove> move_vec;
+    typedef std::integral_constant<bool, std::is_trivially_copyable<TPos>::value && 
+        std::is_trivially_copyable<TMove>::value> is_copyable;
+
+    //  expansions between the time and memory checks
+    static constexpr uint64_t CHECK_PERIOD = 1024;
+    static constexpr uint32_t VERSION = 5;
+
+    struct header {
+        char        magic[4];
+        uint32_t    version;
+        uint32_t    pos_size;       //  sizeof(TPos), guards against the other position types
+        uint32_t    cost_size;      //  sizeof(cost_type)
+        uint32_t    packed;         //  whether the positions are packed
+        uint32_t    num_nodes;
+        uint32_t    has_solution;
+        uint32_t    target_node;
+        uint64_t    num_expanded;
+        uint64_t    problem_key;    //  see problem_key(), guards against the other problems
+        uint64_t    heuristic_key;  //  see heuristic_key(), guards against the other estimates
+    };
 
     const TProblem& _problem;       //  reference to the problem 
     TPos            _source;        //  starting position
-    TPos            _found_target;  //  actually located target position (may differ from the real one)
     bool            _has_solution;  //  whether the solution has been actually found
+    uint32_t        _target_node;   //  actually located target node (its position may differ from the real one)
+    std::vector<TMove>  _known_moves;   //  the rest of the solution, from the found target
+    uint64_t        _num_expanded;  //  number of positions expanded
 
     move_vec        _moves;         //  moves container (transient)
+    TPos            _pos;           //  unpacked expanded position (transient)
+    TPos            _succ;          //  successor position (transient)
+
+    //  successor of a batch, but for the position
+    struct successor {
+        uint32_t    parent;         //  node expanded
+        TMove       move;
+        cost_type   cost_from_src;
+        uint32_t    key;            //  visited registry key
+        uint64_t    packed;         //  packed position
+    };
+
+    uint32_t                _batch_size;    //  nodes expanded per step
+    std::vector<uint32_t>   _batch;         //  nodes expanded by the step (transient)
+    std::vector<TPos>       _succ_pos;      //  successor positions, the new ones moved to the front (transient)
+    std::vector<successor>  _succs;         //  the rest of the successors (transient)
+    std::vector<uint32_t>   _new_nodes;     //  new nodes, to be estimated (transient)
+    std::vector<float>      _estimates;     //  their cost estimates (transient)
 
     node_queue      _front;         //  front node queue
-    node_set        _visited;       //  visited node registry
+    closed_table    _visited;       //  visited node registry, indices into the node columns
+
+    bool                    _packed;            //  whether the positions are packed
+    node_arena<node>        _costs;             //  node columns: costs and the front flag,
+    node_arena<uint32_t>    _parents;           //  the node the move was made from (NONE for the source),
+    node_arena<TMove>       _node_moves;        //  the move that lead to the position,
+    node_arena<TPos>        _positions;         //  the position, either as it is
+    node_arena<uint64_t>    _packed_positions;  //  or packed
+
+    TObserver       _observer;      //  search event observer
+
+    inline cost_type estimate_cost(const TPos& pos) {
+        typename TObserver::timer t(_observer, search_phase::heuristic);
+        return cost_traits::from_float(_problem.estimate_cost(pos));
+    }
+
+    //  ends the search at the target node, or at a node the problem knows the rest of the path from
+    inline bool reached_target(uint32_t idx, const TPos& pos) {
+        if (_problem.is_target(pos)) {
+            //  found the target node, done
+            _target_node = idx;
+            _has_solution = true;
+            return true;
+        }
+        if (known_solution(_problem, pos, _known_moves, 0)) {
+            //  the rest of the path is known (optimal if the heuristic of the position is 
+            //  its exact distance, as it has the lowest total cost)
+            _target_node = idx;
+            _has_solution = true;
+            return true;
+        }
+        return false;
+    }
+
+    //  a better path to a visited node: only the path changes, the cost estimate
+    //  of the position was computed when it was added and is kept.
+    //  The new nodes of a batch are pending, to be pushed to the front queue once estimated
+    inline void update_node(uint32_t idx, uint32_t parent, const TMove& move, cost_type cost_from_src,
+        bool pending = false) {
+        node* pn = &_costs[idx];
+        if (pn->cost_from_src <= cost_from_src) return;
+        if (TObserver::enabled) _observer.on_update(pn->in_front || pending);
+        if (pn->in_front) {
+            //  the node is already in the front queue, replace it
+            typename TObserver::timer t(_observer, search_phase::queue);
+            _front.erase(idx);
+        }
+        pn->cost_from_src   = cost_from_src;
+        _parents[idx]       = parent;
+        _node_moves[idx]    = move;
+        if (pn->in_front) {
+            typename TObserver::timer t(_observer, search_phase::queue);
+            _front.push(idx);
+        }
+    }
+
+    //  expands up to max_nodes front nodes of the same total cost (see set_batch_size)
+    bool step_batch(uint32_t max_nodes) {
+        _batch.clear();
+        {
+            typename TObserver::timer t(_observer, search_phase::queue);
+            uint32_t idx0 = _front.pop();
+            if (idx0 == closed_table::NONE) {
+                //  only stale entries were left in the front queue, no solution
+                return true;
+            }
+            const float cost = _costs[idx0].total_cost();
+            while (true) {
+                _costs[idx0].in_front = false;
+                _batch.push_back(idx0);
+                if (_batch.size() == max_nodes) break;
+                idx0 = _front.top();
+                if (idx0 == closed_table::NONE || _costs[idx0].total_cost() != cost) break;
+                _front.pop();
+            }
+        }
+
+        //  generate the successors of all the nodes, prefetching their registry slots
+        size_t num_succs = 0;
+        for (uint32_t idx0 : _batch) {
+            const TPos& pos0 = get_position(idx0, _pos);
+            if (reached_target(idx0, pos0)) return true;
+
+            _num_expanded++;
+            const node* pn0 = &_costs[idx0];
+            if (TObserver::enabled) _observer.on_expand(pn0->total_cost(), cost_traits::to_float(pn0->cost_from_src));
+            _moves.clear();
+            {
+                typename TObserver::timer t(_observer, search_phase::moves);
+                _problem.get_moves(pos0, _moves);
+            }
+            for (const auto& move : _moves) {
+                if (num_succs == _succs.size()) {
+                    _succ_pos.emplace_back();
+                    _succs.emplace_back();
+                }
+                TPos& succ = _succ_pos[num_succs];
+                successor& s = _succs[num_succs++];
+                _problem.apply_move(pos0, move, succ);
+                s.parent = idx0;
+                s.move = move;
+                s.cost_from_src = (cost_type)(pn0->cost_from_src + cost_traits::from_float(_problem.get_cost(pos0, move)));
+                if (TObserver::enabled) _observer.on_generate();
+
+                typename TObserver::timer t(_observer, search_phase::hashing);
+                s.packed = 0;
+                if (_packed) pack_position(_problem, succ, s.packed, 0);
+                s.key = closed_table::key(position_hash(succ));
+                _visited.prefetch(s.key);
+            }
+        }
+
+        //  resolve the duplicates, adding the new nodes (including the ones repeated in the batch) once
+        _new_nodes.clear();
+        for (size_t i = 0; i < num_succs; i++) {
+            const successor& s = _succs[i];
+            uint32_t idx;
+            {
+                typename TObserver::timer t(_observer, search_phase::hashing);
+                idx = find_node(s.key, _succ_pos[i], s.packed);
+            }
+            if (idx == closed_table::NONE) {
+                //  a completely new node, out of the front queue until estimated
+                const uint32_t idx_new = add_node(_succ_pos[i], s.packed, s.parent, s.move, s.cost_from_src, 0);
+                _costs[idx_new].in_front = false;
+                _visited.insert(s.key, idx_new);
+                if (i != _new_nodes.size()) _succ_pos[_new_nodes.size()] = _succ_pos[i];
+                _new_nodes.push_back(idx_new);
+                continue;
+            }
+            if (TObserver::enabled) _observer.on_duplicate();
+            update_node(idx, s.parent, s.move, s.cost_from_src, !_new_nodes.empty() && idx >= _new_nodes[0]);
+        }
+
+        //  estimate the new nodes at once
+        const size_t num_new = _new_nodes.size();
+        if (num_new > 0) {
+            _estimates.resize(num_new);
+            {
+                typename TObserver::timer t(_observer, search_phase::heuristic);
+                estimate_costs(_problem, &_succ_pos[0], num_new, &_estimates[0], 0);
+            }
+            typename TObserver::timer t(_observer, search_phase::queue);
+            for (size_t i = 0; i < num_new; i++) {
+                node* pn = &_costs[_new_nodes[i]];
+                pn->cost_to_dst = cost_traits::from_float(_estimates[i]);
+                pn->in_front = true;
+                _front.push(_new_nodes[i]);
+            }
+        }
+
+        if (TObserver::enabled) _observer.on_progress(_front.size(), _visited.size(), bytes());
+        return _front.empty();
+    }
+
+    uint32_t add_node(const TPos& pos, uint64_t packed, uint32_t parent, const TMove& move,
+        cost_type cost_from_src, cost_type cost_to_dst) {
+        const uint32_t idx = allocate_node();
+        node* pn = &_costs[idx];
+        pn->cost_from_src   = cost_from_src;
+        pn->cost_to_dst     = cost_to_dst;
+        pn->in_front        = true;
+        _parents[idx]       = parent;
+        _node_moves[idx]    = move;
+        if (_packed) {
+            _packed_positions[idx] = packed;
+        } else {
+            _positions[idx] = pos;
+        }
+        return idx;
+    }
+
+    inline uint32_t allocate_node() {
+        const uint32_t idx = _costs.allocate();
+        _parents.allocate();
+        _node_moves.allocate();
+        if (_packed) {
+            _packed_positions.allocate();
+        } else {
+            _positions.allocate();
+        }
+        return idx;
+    }
+
+    //  the node's position, unpacked into buf if packed
+    inline const TPos& get_position(uint32_t idx, TPos& buf) const {
+        if (!_packed) return _positions[idx];
+        unpack_position(_problem, _packed_positions[idx], buf, 0);
+        return buf;
+    }
+
+    inline uint32_t find_node(uint32_t k, const TPos& pos, uint64_t packed) const {
+        if (_packed) return _visited.find(k, [&](uint32_t idx) { return _packed_positions[idx] == packed; });
+        return _visited.find(k, [&](uint32_t idx) { return _positions[idx] == pos; });
+    }
+
+    template <typename T>
+    static bool write_column(FILE* f, const node_arena<T>& column, uint32_t num_nodes) {
+        for (uint32_t i = 0; i < num_nodes; i++) {
+            if (fwrite(&column[i], sizeof(T), 1, f) != 1) return false;
+        }
+        return true;
+    }
+
+    template <typename T>
+    static bool read_column(FILE* f, node_arena<T>& column, uint32_t num_nodes) {
+        for (uint32_t i = 0; i < num_nodes; i++) {
+            if (fread(&column[i], sizeof(T), 1, f) != 1) return false;
+        }
+        return true;
+    }
+
+    bool save(const std::string& path, std::true_type) const {
+        FILE* f = fopen(path.c_str(), "wb");
+        if (!f) return false;
+        const header h = { { 'A', 'S', 'C', 'P' }, VERSION, (uint32_t)sizeof(TPos), (uint32_t)sizeof(cost_type),
+            _packed ? 1u : 0u, _costs.size(), _has_solution ? 1u : 0u, _target_node, _num_expanded, 
+            problem_key(_problem, 0), heuristic_key(_problem, 0) };
+        bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+            fwrite(&_source, sizeof(TPos), 1, f) == 1 &&
+            write_column(f, _costs, h.num_nodes) && 
+            write_column(f, _parents, h.num_nodes) && 
+            write_column(f, _node_moves, h.num_nodes) &&
+            (_packed ? write_column(f, _packed_positions, h.num_nodes) : write_column(f, _positions, h.num_nodes));
+        //  the rest of the path from a target node known to the problem
+        const uint32_t num_known = (uint32_t)_known_moves.size();
+        ok = ok && fwrite(&num_known, sizeof(num_known), 1, f) == 1 &&
+            (num_known == 0 || fwrite(&_known_moves[0], sizeof(TMove), num_known, f) == num_known);
+        ok = (fclose(f) == 0) && ok;
+        return ok;
+    }
+
+    bool load(const std::string& path, std::true_type) {
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f) return false;
+        header h;
+        TPos source;
+        if (fread(&h, sizeof(h), 1, f) != 1 || memcmp(h.magic, "ASCP", 4) != 0 || 
+            h.version != VERSION || h.pos_size != sizeof(TPos) || h.cost_size != sizeof(cost_type) ||
+            h.packed != (_packed ? 1u : 0u) || h.problem_key != problem_key(_problem, 0) ||
+            h.heuristic_key != heuristic_key(_problem, 0) ||
+            fread(&source, sizeof(TPos), 1, f) != 1 || !(source == _source)) {
+            fclose(f);
+            return false;
+        }
+
+        _costs.reset();
+        _parents.reset();
+        _node_moves.reset();
+        _positions.reset();
+        _packed_positions.reset();
+        _visited.clear();
+        _front = node_queue(node_access(&_costs));
+        _target_node = h.target_node;
+        _known_moves.clear();
+        _has_solution = h.has_solution != 0;
+        _num_expanded = h.num_expanded;
+        for (uint32_t i = 0; i < h.num_nodes; i++) allocate_node();
+        bool ok = read_column(f, _costs, h.num_nodes) && 
+            read_column(f, _parents, h.num_nodes) && 
+            read_column(f, _node_moves, h.num_nodes) &&
+            (_packed ? read_column(f, _packed_positions, h.num_nodes) : read_column(f, _positions, h.num_nodes));
+        uint32_t num_known = 0;
+        ok = ok && fread(&num_known, sizeof(num_known), 1, f) == 1;
+        if (ok && num_known > 0) {
+            _known_moves.resize(num_known);
+            ok = fread(&_known_moves[0], sizeof(TMove), num_known, f) == num_known;
+        }
+        fclose(f);
+        for (uint32_t i = 0; ok && i < h.num_nodes; i++) {
+            const uint32_t k = closed_table::key(position_hash(get_position(i, _pos)));
+            _visited.find(k, [](uint32_t) { return false; });
+            _visited.insert(k, i);
+            if (_costs[i].in_front) _front.push(i);
+        }
+        return ok;
+    }
 
-    node_pool       _pool;          //  node object allocator
+    bool save(const std::string&, std::false_type) const { return false; }
+    bool load(const std::string&, std::false_type) { return false; }
 };
 
 #endif
\ No newline at end of file
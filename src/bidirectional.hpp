@@ -0,0 +1,250 @@
+#ifndef __BIDIRECTIONAL__
+#define __BIDIRECTIONAL__
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+
+#include "astar.hpp"
+#include "node_arena.hpp"
+#include "closed_table.hpp"
+#include "open_list.hpp"
+#include "zobrist.hpp"
+
+//  gets the fully specified target position, if the problem has get_target(res)
+//  and estimate_cost_to(pos, dst), the latter estimating the cost between any two positions
+template <typename TProblem, typename TPos>
+auto full_target(const TProblem& problem, TPos& res, int) ->
+    decltype(problem.get_target(res), problem.estimate_cost_to(res, res), bool()) {
+    return problem.get_target(res);
+}
+
+template <typename TProblem, typename TPos>
+bool full_target(const TProblem&, TPos&, long) { return false; }
+
+template <typename TProblem, typename TPos>
+auto estimate_cost_to(const TProblem& problem, const TPos& pos, const TPos& dst, int) ->
+    decltype(problem.estimate_cost_to(pos, dst)) {
+    return problem.estimate_cost_to(pos, dst);
+}
+
+template <typename TProblem, typename TPos>
+float estimate_cost_to(const TProblem&, const TPos&, const TPos&, long) { return 0.0f; }
+
+//  Bidirectional front-to-end search (MM): one search forwards from the source,
+//  another one backwards from the target, the heuristic of the latter estimating
+//  the cost to the source. Both expand the nodes by the priority max(f, 2g),
+//  so neither goes further than half the solution cost from its end,
+//  and the one with the lower priority goes first. The best path through a position
+//  reached from both ends is kept, until its cost is no more than the lowest priority,
+//  which is a lower bound for all the paths not found yet.
+//  The solution is optimal if the heuristics are admissible.
+//
+//  The moves are expected to be reversible with the same cost (which holds for
+//  the sliding puzzles), so the backward search expands the positions with get_moves
+//  as well, and the moves of its half of the path are found again, in reverse,
+//  when the solution is rebuilt.
+//
+//  Falls back to astar if the target is partial (or the problem can't tell it).
+template <typename TProblem, typename TPos = typename TProblem::position,
+    typename TMove = typename TProblem::move, typename TQueuePolicy = bucket_queue_policy<>>
+class bidirectional {
+public:
+    typedef astar<TProblem, TPos, TMove, TQueuePolicy> unidirectional;
+
+    bidirectional(const TProblem& problem, const TPos& source) :
+        _problem(problem), _source(source), _has_solution(false), _done(false),
+        _best_cost(std::numeric_limits<float>::max()), _num_expanded(0) {
+        if (!full_target(_problem, _target, 0)) {
+            _fallback.reset(new unidirectional(problem, source));
+            return;
+        }
+        add(FORWARD, _source, TMove(), 0.0f, closed_table::key(position_hash(_source)));
+        add(BACKWARD, _target, TMove(), 0.0f, closed_table::key(position_hash(_target)));
+        if (_source == _target) {
+            _best_cost = 0.0f;
+            _meeting = _source;
+            _has_solution = true;
+        }
+    }
+
+    bool step() {
+        if (_fallback) return _fallback->step();
+        if (_done) return true;
+
+        node* pnf = _sides[FORWARD].front.top();
+        node* pnb = _sides[BACKWARD].front.top();
+        if (pnf == nullptr || pnb == nullptr) {
+            //  one of the ends is exhausted, no more paths
+            _done = true;
+            return true;
+        }
+        if (_best_cost <= std::min(pnf->total_cost(), pnb->total_cost())) {
+            //  no path not found yet can be shorter
+            _done = true;
+            return true;
+        }
+        expand(pnb->total_cost() < pnf->total_cost() ? BACKWARD : FORWARD);
+        return false;
+    }
+
+    void solve() {
+        while (!step()) {
+        }
+    }
+
+    bool get_solution(std::vector<TMove>& res) const {
+        if (_fallback) return _fallback->get_solution(res);
+        if (!_has_solution) return false;
+        res.clear();
+
+        //  the forward half, from the meeting position back to the source
+        TPos pos = _meeting;
+        while (!(pos == _source)) {
+            const node* pn = find_node(FORWARD, pos);
+            if (pn == nullptr) return false;
+            _problem.unapply_move(pn->pos, pn->move, pos);
+            res.push_back(pn->move);
+        }
+        std::reverse(res.begin(), res.end());
+
+        //  the backward half, from the meeting position to the target:
+        //  the backward search got to every position by a move from the next one
+        std::vector<TMove> moves;
+        TPos next, succ;
+        pos = _meeting;
+        while (!(pos == _target)) {
+            const node* pn = find_node(BACKWARD, pos);
+            if (pn == nullptr) return false;
+            _problem.unapply_move(pn->pos, pn->move, next);
+            moves.clear();
+            _problem.get_moves(pos, moves);
+            auto it = std::find_if(moves.begin(), moves.end(), [&](const TMove& m) {
+                _problem.apply_move(pos, m, succ);
+                return succ == next;
+            });
+            if (it == moves.end()) return false;
+            res.push_back(*it);
+            pos = next;
+        }
+
+        resolve_moves(_problem, _source, res, 0);
+        return true;
+    }
+
+    //  whether the search is actually bidirectional (the target is fully specified)
+    bool is_bidirectional() const { return !_fallback; }
+
+    uint32_t num_visited() const {
+        if (_fallback) return _fallback->num_visited();
+        return _sides[FORWARD].visited.size() + _sides[BACKWARD].visited.size();
+    }
+
+    //  number of positions expanded by the bidirectional search
+    uint64_t num_expanded() const { return _num_expanded; }
+
+private:
+    enum { FORWARD = 0, BACKWARD = 1 };
+
+    struct node {
+        TPos    pos;            //  node's position
+        TMove   move;           //  move that lead to this pos (from the source or the target side)
+        float   cost_from_src;  //  cost from the search end (real one)
+        float   cost_to_dst;    //  heuristically estimated cost to the opposite end
+        bool    in_front;       //  whether this node is still in the front queue
+
+        //  MM priority
+        inline float total_cost() const {
+            return std::max(cost_from_src + cost_to_dst, 2.0f*cost_from_src);
+        }
+    };
+
+    typedef typename TQueuePolicy::template queue<node> node_queue;
+
+    struct side {
+        node_queue          front;      //  front node queue
+        closed_table        visited;    //  visited node registry, indices into nodes
+        node_arena<node>    nodes;      //  node storage
+    };
+
+    const TProblem&                 _problem;       //  reference to the problem
+    TPos                            _source;        //  starting position
+    TPos                            _target;        //  target position
+    TPos                            _meeting;       //  position on the best path found
+    bool                            _has_solution;  //  whether a path has been found
+    bool                            _done;          //  whether the search is over
+    float                           _best_cost;     //  cost of the best path found
+    uint64_t                        _num_expanded;
+
+    side                            _sides[2];      //  forward and backward searches
+    std::unique_ptr<unidirectional> _fallback;      //  the search for the partial targets
+
+    std::vector<TMove>              _moves;         //  moves container (transient)
+    TPos                            _succ;          //  successor position (transient)
+
+    inline const node* find_node(int dir, const TPos& pos) const {
+        const side& s = _sides[dir];
+        const uint32_t idx = s.visited.find(closed_table::key(position_hash(pos)),
+            [&](uint32_t i) { return s.nodes[i].pos == pos; });
+        return idx == closed_table::NONE ? nullptr : &s.nodes[idx];
+    }
+
+    void expand(int dir) {
+        side& s = _sides[dir];
+        node* pn0 = s.front.pop();
+        pn0->in_front = false;
+        _num_expanded++;
+
+        _moves.clear();
+        _problem.get_moves(pn0->pos, _moves);
+        for (const auto& move : _moves) {
+            _problem.apply_move(pn0->pos, move, _succ);
+            const float cost_from_src = pn0->cost_from_src + _problem.get_cost(pn0->pos, move);
+            add(dir, _succ, move, cost_from_src, closed_table::key(position_hash(_succ)));
+
+            //  reached from the other end as well
+            const side& o = _sides[1 - dir];
+            const uint32_t idx = o.visited.find(closed_table::key(position_hash(_succ)),
+                [&](uint32_t i) { return o.nodes[i].pos == _succ; });
+            if (idx == closed_table::NONE) continue;
+            const float cost = cost_from_src + o.nodes[idx].cost_from_src;
+            if (cost < _best_cost) {
+                _best_cost = cost;
+                _meeting = _succ;
+                _has_solution = true;
+            }
+        }
+    }
+
+    //  adds the node reached with the given cost, or updates the visited one
+    void add(int dir, const TPos& pos, const TMove& move, float cost_from_src, uint32_t k) {
+        side& s = _sides[dir];
+        const uint32_t idx = s.visited.find(k, [&](uint32_t i) { return s.nodes[i].pos == pos; });
+        if (idx == closed_table::NONE) {
+            const uint32_t idx_new = s.nodes.allocate();
+            node* pnew = &s.nodes[idx_new];
+            pnew->pos           = pos;
+            pnew->move          = move;
+            pnew->cost_from_src = cost_from_src;
+            pnew->cost_to_dst   = (dir == FORWARD) ? _problem.estimate_cost(pos) :
+                                    estimate_cost_to(_problem, pos, _source, 0);
+            pnew->in_front      = true;
+            s.front.push(pnew);
+            s.visited.insert(k, idx_new);
+            return;
+        }
+        node* pn = &s.nodes[idx];
+        if (pn->cost_from_src > cost_from_src) {
+            //  a better path: update the node, reopening it if it had been expanded
+            if (pn->in_front) s.front.erase(pn);
+            pn->cost_from_src   = cost_from_src;
+            pn->move            = move;
+            pn->in_front        = true;
+            s.front.push(pn);
+        }
+    }
+};
+
+#endif // __BIDIRECTIONAL__
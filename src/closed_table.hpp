@@ -0,0 +1,169 @@
+#ifndef __CLOSED_TABLE__
+#define __CLOSED_TABLE__
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+//  open-addressed (linear probing) hash table of 32-bit node indices.
+//  Each slot keeps the 32-bit mixed hash next to the index, so the probe sequence
+//  rarely has to look at the nodes themselves, and the table can be grown without
+//  rehashing the positions. Slots are 8 bytes, the table is cache line aligned.
+//  Entries are never removed.
+class closed_table {
+public:
+    static constexpr uint32_t NONE = 0xFFFFFFFF;
+
+    struct stats {
+        uint64_t    lookups;        //  number of probe sequences done
+        uint64_t    probes;         //  total number of slots inspected
+        uint32_t    max_probes;     //  longest probe sequence
+        uint64_t    collisions;     //  key matches for non-equal entries
+
+        double avg_probes() const { return lookups ? (double)probes/lookups : 0.0; }
+        double collision_rate() const { return lookups ? (double)collisions/lookups : 0.0; }
+    };
+
+    closed_table(uint32_t capacity = 1024, float max_load = 0.7f) :
+        _slots(nullptr), _size(0), _max_load(max_load), _stats{ 0, 0, 0, 0 } {
+        uint32_t cap = 16;
+        while (cap < capacity) cap <<= 1;
+        alloc(cap);
+    }
+
+    ~closed_table() {
+        free_slots();
+    }
+
+    closed_table(const closed_table&) = delete;
+    closed_table& operator =(const closed_table&) = delete;
+
+    //  mixes the position hash into the 32-bit key used by the table
+    static inline uint32_t key(size_t hash) {
+        return (uint32_t)(((uint64_t)hash*0x9E3779B97F4A7C15ull) >> 32);
+    }
+
+    //  looks for an index with the given key; eq(idx) must check whether the node
+    //  at idx is the one being looked for. Returns the found index or NONE, in the
+    //  latter case the slot to be used by insert() is remembered
+    template <typename TEq>
+    uint32_t find(uint32_t k, const TEq& eq) const {
+        uint32_t pos = k & _mask;
+        uint32_t nprobes = 1;
+        while (true) {
+            const slot& s = _slots[pos];
+            if (s.idx == NONE) break;
+            if (s.key == k) {
+                if (eq(s.idx)) {
+                    update_stats(nprobes);
+                    return s.idx;
+                }
+                _stats.collisions++;
+            }
+            pos = (pos + 1) & _mask;
+            nprobes++;
+        }
+        update_stats(nprobes);
+        _free_pos = pos;
+        _free_key = k;
+        return NONE;
+    }
+
+    //  starts loading the first slot find(k) is going to probe, for the batched lookups
+    inline void prefetch(uint32_t k) const {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        _mm_prefetch((const char*)&_slots[k & _mask], _MM_HINT_T0);
+#elif defined(__GNUC__)
+        __builtin_prefetch(&_slots[k & _mask]);
+#endif
+    }
+
+    //  inserts the index into the slot located by the previous unsuccessful find()
+    void insert(uint32_t k, uint32_t idx) {
+        assert(k == _free_key && _slots[_free_pos].idx == NONE);
+        _slots[_free_pos] = { k, idx };
+        _size++;
+        if (_size > (uint32_t)(_capacity*_max_load)) grow();
+    }
+
+    //  removes all the entries, keeping the capacity
+    void clear() {
+        memset(_slots, 0xFF, _capacity*sizeof(slot));
+        _size = 0;
+        _stats = { 0, 0, 0, 0 };
+    }
+
+    uint32_t size() const { return _size; }
+    uint32_t capacity() const { return _capacity; }
+    float load_factor() const { return (float)_size/_capacity; }
+    const stats& get_stats() const { return _stats; }
+    uint64_t bytes() const { return (uint64_t)_capacity*sizeof(slot); }
+
+    template <typename TFn>
+    void for_each(const TFn& fn) const {
+        for (uint32_t i = 0; i < _capacity; i++) {
+            if (_slots[i].idx != NONE) fn(_slots[i].idx);
+        }
+    }
+
+private:
+    struct slot {
+        uint32_t    key;    //  mixed hash
+        uint32_t    idx;    //  node index, NONE if the slot is empty
+    };
+
+    static constexpr size_t CACHE_LINE = 64;
+
+    slot*       _slots;     //  slots memory, cache line aligned
+    void*       _mem;       //  raw slots memory
+    uint32_t    _capacity;  //  number of slots, power of two
+    uint32_t    _mask;      //  _capacity - 1
+    uint32_t    _size;      //  number of occupied slots
+    float       _max_load;  //  load factor to grow the table at
+    mutable uint32_t    _free_pos;  //  free slot located by the last unsuccessful find()
+    mutable uint32_t    _free_key;  //  key used in the last unsuccessful find()
+    mutable stats       _stats;     //  probing statistics
+
+    void alloc(uint32_t capacity) {
+        _capacity = capacity;
+        _mask = capacity - 1;
+        _mem = malloc(capacity*sizeof(slot) + CACHE_LINE);
+        _slots = (slot*)(((uintptr_t)_mem + CACHE_LINE - 1) & ~(uintptr_t)(CACHE_LINE - 1));
+        memset(_slots, 0xFF, capacity*sizeof(slot));
+    }
+
+    void free_slots() {
+        ::free(_mem);
+        _mem = nullptr;
+        _slots = nullptr;
+    }
+
+    void grow() {
+        slot* old_slots = _slots;
+        void* old_mem = _mem;
+        const uint32_t old_capacity = _capacity;
+        alloc(old_capacity*2);
+        for (uint32_t i = 0; i < old_capacity; i++) {
+            const slot& s = old_slots[i];
+            if (s.idx == NONE) continue;
+            uint32_t pos = s.key & _mask;
+            while (_slots[pos].idx != NONE) pos = (pos + 1) & _mask;
+            _slots[pos] = s;
+        }
+        ::free(old_mem);
+    }
+
+    inline void update_stats(uint32_t nprobes) const {
+        _stats.lookups++;
+        _stats.probes += nprobes;
+        _stats.max_probes = std::max(_stats.max_probes, nprobes);
+    }
+};
+
+#endif // __CLOSED_TABLE__
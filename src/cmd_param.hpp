@@ -19,7 +19,9 @@ public:
 		std::string prefix = "--";
 		prefix += param_name;
 		for (auto& arg : _args) {
-			if (arg.compare(0, prefix.size(), prefix) == 0)
+			//  the whole name, so that e.g. --weight does not match --weight_step
+			if (arg.compare(0, prefix.size(), prefix) == 0 &&
+				(arg.size() == prefix.size() || arg[prefix.size()] == '='))
 			{
 				std::istringstream is(arg);
 				is.ignore(prefix.size() + 1, ' ');
@@ -0,0 +1,91 @@
+#ifndef __CPU_FEATURES__
+#define __CPU_FEATURES__
+
+#include <cstdint>
+#include <atomic>
+
+//  x86 SIMD kernels are compiled regardless of the compiler flags and picked at run time:
+//  the functions using the instruction set extensions are marked with SP_TARGET_SSSE3 or
+//  SP_TARGET_AVX2 (GCC and Clang need it to allow the intrinsics, MSVC does not),
+//  and only called if cpu_features::level() says so. SP_X86 is not defined elsewhere,
+//  where the scalar code is used
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SP_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SP_TARGET_SSSE3
+#define SP_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define SP_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define SP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+enum class simd_level { scalar, ssse3, avx2 };
+
+class cpu_features {
+public:
+    //  the best level the processor (and the OS, for AVX2) supports
+    static simd_level supported() {
+        static const simd_level level = detect();
+        return level;
+    }
+
+    //  the level the kernels use, the supported one unless lowered (e.g. for comparing them)
+    static simd_level level() { return (simd_level)level_ref().load(); }
+
+    static void set_level(simd_level level) {
+        if (level > supported()) level = supported();
+        level_ref().store((int)level);
+    }
+
+private:
+    static std::atomic<int>& level_ref() {
+        static std::atomic<int> level((int)supported());
+        return level;
+    }
+
+    static simd_level detect() {
+#ifdef SP_X86
+        uint32_t regs[4] = { 0, 0, 0, 0 };     //  eax, ebx, ecx, edx
+        cpuid(0, regs);
+        const uint32_t max_leaf = regs[0];
+        if (max_leaf < 1) return simd_level::scalar;
+        cpuid(1, regs);
+        if (!(regs[2] & (1u << 9))) return simd_level::scalar;
+        //  AVX2 needs the OS to save the YMM registers (OSXSAVE, then XCR0 bits 1 and 2)
+        const bool osxsave = (regs[2] & (1u << 27)) != 0;
+        if (max_leaf < 7 || !osxsave || (xgetbv() & 6) != 6) return simd_level::ssse3;
+        cpuid(7, regs);
+        return (regs[1] & (1u << 5)) ? simd_level::avx2 : simd_level::ssse3;
+#else
+        return simd_level::scalar;
+#endif
+    }
+
+#ifdef SP_X86
+    static void cpuid(uint32_t leaf, uint32_t* regs) {
+#ifdef _MSC_VER
+        int r[4];
+        __cpuidex(r, (int)leaf, 0);
+        for (int i = 0; i < 4; i++) regs[i] = (uint32_t)r[i];
+#else
+        __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    }
+
+    static uint64_t xgetbv() {
+#ifdef _MSC_VER
+        return _xgetbv(0);
+#else
+        uint32_t lo, hi;
+        __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        return ((uint64_t)hi << 32) | lo;
+#endif
+    }
+#endif
+};
+
+#endif // __CPU_FEATURES__
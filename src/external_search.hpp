@@ -0,0 +1,344 @@
+#ifndef __EXTERNAL_SEARCH__
+#define __EXTERNAL_SEARCH__
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <queue>
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+#include <type_traits>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include "astar.hpp"
+
+//  Breadth first search with the layers kept on disk, for the state spaces not fitting the memory.
+//
+//  Every layer is a file of the positions, sorted by their bytes and front coded (each record
+//  stores the number of the leading bytes shared with the previous one, and the rest of them).
+//  The successors of a layer are collected in memory up to the memory limit, then sorted and
+//  written out as a run file; the runs are merged into the next layer, dropping the duplicates
+//  and the positions of the two previous layers on the way (delayed duplicate detection).
+//  The moves are expected to be reversible (as in the sliding puzzles), so that a successor
+//  can't be in an earlier layer, and the solution is rebuilt backwards from the target,
+//  by looking up its neighbors in every previous layer file.
+//
+//  The positions are compared by their bytes, so they have to be trivially copyable
+//  and without padding (as sliding_puzzle::fixed_position). Every move counts as one,
+//  the solution has the fewest moves.
+template <typename TProblem, typename TPos = typename TProblem::position,
+    typename TMove = typename TProblem::move>
+class external_search {
+    static_assert(std::is_trivially_copyable<TPos>::value, "Position must be trivially copyable");
+    static_assert(sizeof(TPos) < 256, "Position must be shorter than 256 bytes");
+
+public:
+    static constexpr size_t DEFAULT_MEMORY = (size_t)256 << 20;
+
+    //  the files are created in the given directory, and removed by the destructor
+    external_search(const TProblem& problem, const TPos& source, const std::string& dir,
+        size_t memory_limit = DEFAULT_MEMORY) :
+        _problem(problem), _source(source), _has_solution(false), _done(false), _failed(false),
+        _buffer_size(std::max(memory_limit/sizeof(TPos), (size_t)16)),
+        _num_expanded(0), _num_runs(0), _bytes_written(0) {
+        _prefix = (dir.empty() ? std::string(".") : dir) + "/ddd" +
+            std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "_";
+        record_writer w;
+        if (!w.open(layer_path(0))) {
+            _failed = _done = true;
+            return;
+        }
+        w.write(_source);
+        _layer_sizes.push_back(1);
+        if (!close(w)) return;
+        if (_problem.is_target(_source)) {
+            _found_target = _source;
+            _has_solution = _done = true;
+        }
+    }
+
+    external_search(const external_search&) = delete;
+    external_search& operator =(const external_search&) = delete;
+
+    ~external_search() {
+        for (size_t i = 0; i < _layer_sizes.size(); i++) std::remove(layer_path((int)i).c_str());
+    }
+
+    //  expands the last layer, returns true once done
+    bool step() {
+        if (_done) return true;
+        const int d = depth();
+
+        //  the successors, in the sorted runs
+        std::vector<std::string> runs;
+        {
+            record_reader r;
+            if (!r.open(layer_path(d))) return fail(runs);
+            std::vector<TPos> buffer;
+            TPos pos;
+            while (r.read(pos)) {
+                _num_expanded++;
+                _moves.clear();
+                _problem.get_moves(pos, _moves);
+                for (const auto& move : _moves) {
+                    _problem.apply_move(pos, move, _succ);
+                    buffer.push_back(_succ);
+                    if (buffer.size() >= _buffer_size && !write_run(buffer, runs)) return fail(runs);
+                }
+            }
+            if (!buffer.empty() && !write_run(buffer, runs)) return fail(runs);
+        }
+
+        //  merged, without the duplicates and the positions of the previous two layers
+        std::vector<std::unique_ptr<record_reader>> readers;
+        std::priority_queue<run_head, std::vector<run_head>, run_head_greater> heads;
+        for (const auto& path : runs) {
+            readers.emplace_back(new record_reader);
+            run_head h = { TPos(), (int)readers.size() - 1 };
+            if (!readers.back()->open(path)) {
+                readers.clear();
+                return fail(runs);
+            }
+            if (readers.back()->read(h.pos)) heads.push(h);
+        }
+        layer_cursor prev1(layer_path(d)), prev2(d > 0 ? layer_path(d - 1) : std::string());
+
+        record_writer w;
+        if (!w.open(layer_path(d + 1))) {
+            readers.clear();
+            return fail(runs);
+        }
+        _layer_sizes.push_back(0);
+        TPos last;
+        bool has_last = false;
+        while (!heads.empty()) {
+            run_head h = heads.top();
+            heads.pop();
+            const TPos pos = h.pos;
+            if (readers[h.run]->read(h.pos)) heads.push(h);
+
+            if (has_last && equal(pos, last)) continue;
+            last = pos;
+            has_last = true;
+            if (prev1.skip_to(pos) || prev2.skip_to(pos)) continue;
+
+            w.write(pos);
+            _layer_sizes.back()++;
+            if (!_has_solution && _problem.is_target(pos)) {
+                _found_target = pos;
+                _has_solution = true;
+            }
+        }
+        readers.clear();
+        for (const auto& path : runs) std::remove(path.c_str());
+        if (!close(w)) return true;
+
+        _done = _has_solution || _layer_sizes.back() == 0;
+        return _done;
+    }
+
+    void solve() {
+        while (!step()) {
+        }
+    }
+
+    bool get_solution(std::vector<TMove>& res) const {
+        if (!_has_solution) return false;
+        res.clear();
+        std::vector<TMove> moves;
+        std::vector<TPos> neighbors;
+        TPos pos = _found_target, prev, succ;
+        for (int d = depth() - 1; d >= 0; d--) {
+            //  the position of the previous layer a move away (the moves being reversible)
+            moves.clear();
+            _problem.get_moves(pos, moves);
+            neighbors.clear();
+            for (const auto& m : moves) {
+                _problem.apply_move(pos, m, succ);
+                neighbors.push_back(succ);
+            }
+            std::sort(neighbors.begin(), neighbors.end(), less);
+
+            record_reader r;
+            if (!r.open(layer_path(d))) return false;
+            bool found = false;
+            while (!found && r.read(prev)) {
+                found = std::binary_search(neighbors.begin(), neighbors.end(), prev, less);
+            }
+            if (!found) return false;
+
+            moves.clear();
+            _problem.get_moves(prev, moves);
+            auto it = std::find_if(moves.begin(), moves.end(), [&](const TMove& m) {
+                _problem.apply_move(prev, m, succ);
+                return succ == pos;
+            });
+            if (it == moves.end()) return false;
+            res.push_back(*it);
+            pos = prev;
+        }
+        std::reverse(res.begin(), res.end());
+        resolve_moves(_problem, _source, res, 0);
+        return true;
+    }
+
+    bool has_solution() const { return _has_solution; }
+    //  whether a file could not be written or read
+    bool failed() const { return _failed; }
+
+    //  number of the layers expanded, the distance of the last one from the source
+    int depth() const { return (int)_layer_sizes.size() - 1; }
+    const std::vector<uint64_t>& layer_sizes() const { return _layer_sizes; }
+
+    uint64_t num_visited() const {
+        uint64_t res = 0;
+        for (auto n : _layer_sizes) res += n;
+        return res;
+    }
+
+    uint64_t num_expanded() const { return _num_expanded; }
+    //  number of the sorted run files written (more than one per layer if out of the memory limit)
+    uint64_t num_runs() const { return _num_runs; }
+    uint64_t bytes_written() const { return _bytes_written; }
+
+private:
+    static bool less(const TPos& a, const TPos& b) {
+        return memcmp(&a, &b, sizeof(TPos)) < 0;
+    }
+
+    static bool equal(const TPos& a, const TPos& b) {
+        return memcmp(&a, &b, sizeof(TPos)) == 0;
+    }
+
+    //  front coded position file
+    class record_writer {
+    public:
+        bool open(const std::string& path) {
+            _fs.open(path, std::ios::binary | std::ios::trunc);
+            _first = true;
+            _bytes = 0;
+            return _fs.is_open();
+        }
+
+        void write(const TPos& pos) {
+            const unsigned char* p = (const unsigned char*)&pos;
+            size_t shared = 0;
+            if (!_first) {
+                while (shared < sizeof(TPos) && p[shared] == _prev[shared]) shared++;
+            }
+            _first = false;
+            _fs.put((char)shared);
+            _fs.write((const char*)p + shared, sizeof(TPos) - shared);
+            _bytes += 1 + sizeof(TPos) - shared;
+            memcpy(_prev, p, sizeof(TPos));
+        }
+
+        bool close() {
+            _fs.close();
+            return !_fs.fail();
+        }
+
+        uint64_t bytes() const { return _bytes; }
+
+    private:
+        std::ofstream   _fs;
+        unsigned char   _prev[sizeof(TPos)];
+        bool            _first;
+        uint64_t        _bytes;
+    };
+
+    class record_reader {
+    public:
+        bool open(const std::string& path) {
+            _fs.open(path, std::ios::binary);
+            return _fs.is_open();
+        }
+
+        bool read(TPos& res) {
+            const int shared = _fs.get();
+            if (shared == EOF || shared > (int)sizeof(TPos)) return false;
+            if (!_fs.read((char*)_prev + shared, sizeof(TPos) - shared)) return false;
+            memcpy(&res, _prev, sizeof(TPos));
+            return true;
+        }
+
+    private:
+        std::ifstream   _fs;
+        unsigned char   _prev[sizeof(TPos)];
+    };
+
+    //  sequential lookups in a layer file, for the increasing positions
+    class layer_cursor {
+    public:
+        layer_cursor(const std::string& path) : _valid(false) {
+            if (!path.empty() && _reader.open(path)) _valid = _reader.read(_pos);
+        }
+
+        //  whether the layer has the position
+        bool skip_to(const TPos& pos) {
+            while (_valid && less(_pos, pos)) _valid = _reader.read(_pos);
+            return _valid && equal(_pos, pos);
+        }
+
+    private:
+        record_reader   _reader;
+        TPos            _pos;
+        bool            _valid;
+    };
+
+    struct run_head {
+        TPos    pos;    //  the smallest position not merged yet
+        int     run;    //  its run
+    };
+
+    struct run_head_greater {
+        bool operator ()(const run_head& a, const run_head& b) const { return less(b.pos, a.pos); }
+    };
+
+    const TProblem&         _problem;       //  reference to the problem
+    TPos                    _source;        //  starting position
+    TPos                    _found_target;  //  the target position found
+    bool                    _has_solution;  //  whether a solution has been found
+    bool                    _done;          //  whether the search is over
+    bool                    _failed;        //  whether a file operation failed
+    std::string             _prefix;        //  path prefix of the files
+    size_t                  _buffer_size;   //  positions sorted in memory at once
+
+    std::vector<uint64_t>   _layer_sizes;   //  number of the positions per layer
+    uint64_t                _num_expanded;
+    uint64_t                _num_runs;
+    uint64_t                _bytes_written;
+
+    std::vector<TMove>      _moves;         //  moves container (transient)
+    TPos                    _succ;          //  successor position (transient)
+
+    std::string layer_path(int d) const { return _prefix + "layer" + std::to_string(d) + ".bin"; }
+
+    bool close(record_writer& w) {
+        _bytes_written += w.bytes();
+        if (!w.close()) _failed = _done = true;
+        return !_failed;
+    }
+
+    bool write_run(std::vector<TPos>& buffer, std::vector<std::string>& runs) {
+        std::sort(buffer.begin(), buffer.end(), less);
+        buffer.erase(std::unique(buffer.begin(), buffer.end(), equal), buffer.end());
+        runs.push_back(_prefix + "run" + std::to_string(_num_runs++) + ".bin");
+        record_writer w;
+        if (!w.open(runs.back())) return false;
+        for (const auto& pos : buffer) w.write(pos);
+        buffer.clear();
+        return close(w);
+    }
+
+    bool fail(const std::vector<std::string>& runs) {
+        for (const auto& path : runs) std::remove(path.c_str());
+        _failed = _done = true;
+        return true;
+    }
+};
+
+#endif // __EXTERNAL_SEARCH__
@@ -15,7 +15,7 @@ public:
         int x, y;
 
         size_t operator () () const {
-            return x*y;
+            return ((size_t)(uint32_t)y << 16) ^ (size_t)(uint32_t)x;
         }
 
         bool operator == (const position& rhs) const {
@@ -49,6 +49,15 @@ public:
         return pos == target;
     }
 
+    bool get_target(position& res) const {
+        res = target;
+        return true;
+    }
+
+    float estimate_cost_to(const position& pos, const position& dst) const {
+        return (float)(abs(pos.x - dst.x) + abs(pos.y - dst.y));
+    }
+
     void apply_move(const position& pos, const move& m, position& new_pos) const {
         new_pos = { pos.x + m.dx, pos.y + m.dy };
     }
@@ -0,0 +1,348 @@
+#ifndef __HDASTAR__
+#define __HDASTAR__
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+
+#include "astar.hpp"
+#include "node_arena.hpp"
+#include "closed_table.hpp"
+#include "open_list.hpp"
+#include "zobrist.hpp"
+
+//  Hash distributed parallel A* (HDA*).
+//
+//  Every position is owned by a thread, chosen by the position hash. Each thread has its own
+//  open list, closed table and node storage, and only expands the positions it owns.
+//  The successors owned by other threads are sent to them in batches, via lock-free
+//  multiple-producer single-consumer stacks (the consumer takes the whole stack at once).
+//
+//  As the expansions are not globally ordered by the total cost, a target found is only
+//  an incumbent solution: the threads keep expanding the nodes with the total cost below
+//  the incumbent's one (reopening the nodes reached with a lower cost from source),
+//  until all the open lists are empty and no messages are in flight.
+//  The termination is detected with a single counter of the busy threads plus the batches
+//  in flight: a thread receiving a batch gets busy before the batch stops being in flight,
+//  so the counter only drops to zero once, when no work is left anywhere.
+//  The solution is optimal if the heuristic is admissible.
+template <typename TProblem, typename TPos = typename TProblem::position,
+    typename TMove = typename TProblem::move, typename TQueuePolicy = bucket_queue_policy<>>
+class hdastar {
+public:
+    //  num_threads = 0 uses all the hardware threads
+    hdastar(const TProblem& problem, const TPos& source, int num_threads = 0) :
+        _problem(problem), _source(source), _has_solution(false),
+        _best_cost(std::numeric_limits<float>::max()), _pending(0), _done(false) {
+        if (num_threads <= 0) num_threads = std::max(1, (int)std::thread::hardware_concurrency());
+        //  all the threads start busy
+        _pending.store(num_threads);
+        for (int i = 0; i < num_threads; i++) _workers.emplace_back(new worker(*this, i));
+
+        worker& w = *_workers[owner(position_hash(_source))];
+        const uint32_t k = closed_table::key(position_hash(_source));
+        w.visited.find(k, [](uint32_t) { return false; });
+        const uint32_t idx0 = w.nodes.allocate();
+        node* pn0 = &w.nodes[idx0];
+        *pn0 = { _source, TMove(), 0.0f, _problem.estimate_cost(_source), true };
+        w.front.push(pn0);
+        w.visited.insert(k, idx0);
+    }
+
+    hdastar(const hdastar&) = delete;
+    hdastar& operator =(const hdastar&) = delete;
+
+    void solve() {
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < _workers.size(); i++) {
+            threads.emplace_back([this, i] { _workers[i]->run(); });
+        }
+        _workers[0]->run();
+        for (auto& t : threads) t.join();
+    }
+
+    bool get_solution(std::vector<TMove>& res) const {
+        if (!_has_solution) return false;
+        res.clear();
+        TPos pos = _found_target;
+        while (!(pos == _source)) {
+            const worker& w = *_workers[owner(position_hash(pos))];
+            const uint32_t idx = w.find_node(closed_table::key(position_hash(pos)), pos);
+            if (idx == closed_table::NONE) {
+                return false;
+            }
+            const node* pn = &w.nodes[idx];
+            _problem.unapply_move(pn->pos, pn->move, pos);
+            res.push_back(pn->move);
+        }
+        std::reverse(res.begin(), res.end());
+        resolve_moves(_problem, _source, res, 0);
+        return true;
+    }
+
+    int num_threads() const { return (int)_workers.size(); }
+
+    uint32_t num_visited() const {
+        uint32_t res = 0;
+        for (const auto& w : _workers) res += w->visited.size();
+        return res;
+    }
+
+    uint64_t num_expanded() const {
+        uint64_t res = 0;
+        for (const auto& w : _workers) res += w->num_expanded;
+        return res;
+    }
+
+    //  number of the positions sent to the other threads
+    uint64_t num_sent() const {
+        uint64_t res = 0;
+        for (const auto& w : _workers) res += w->num_sent;
+        return res;
+    }
+
+private:
+    static constexpr int BATCH_SIZE = 128;
+    //  number of expansions after which the partially filled batches are sent anyway
+    static constexpr int FLUSH_PERIOD = 32;
+
+    struct node {
+        TPos    pos;            //  node's position
+        TMove   move;           //  move that lead to this pos
+        float   cost_from_src;  //  cost from source node (real one)
+        float   cost_to_dst;    //  heuristically estimated cost to target node
+        bool    in_front;       //  whether this node is still in the front queue
+
+        inline float total_cost() const {
+            return cost_from_src + cost_to_dst;
+        }
+    };
+
+    //  successor sent to its owner
+    struct message {
+        TPos    pos;
+        TMove   move;
+        float   cost_from_src;
+    };
+
+    struct batch {
+        batch*      next;
+        int         size;
+        message     items[BATCH_SIZE];
+    };
+
+    typedef typename TQueuePolicy::template queue<node> node_queue;
+
+    struct worker {
+        hdastar&                _search;
+        int                     _id;
+
+        node_queue              front;          //  front node queue
+        closed_table            visited;        //  visited node registry, indices into nodes
+        node_arena<node>        nodes;          //  node storage
+        std::atomic<batch*>     inbox;          //  batches sent to this thread
+        std::vector<batch*>     outbox;         //  batches being filled, per thread
+        bool                    idle;
+        std::mutex              wake_mutex;     //  guards the sleeping on wake
+        std::condition_variable wake;           //  signaled on a batch sent or the search done
+
+        std::vector<TMove>      moves;          //  moves container (transient)
+        TPos                    succ;           //  successor position (transient)
+        uint64_t                num_expanded;
+        uint64_t                num_sent;
+
+        worker(hdastar& search, int id) :
+            _search(search), _id(id), inbox(nullptr), idle(false), num_expanded(0), num_sent(0) {}
+
+        ~worker() {
+            for (auto b : outbox) delete b;
+            for (batch* b = inbox.load(); b; ) {
+                batch* next = b->next;
+                delete b;
+                b = next;
+            }
+        }
+
+        inline uint32_t find_node(uint32_t k, const TPos& pos) const {
+            return visited.find(k, [&](uint32_t idx) { return nodes[idx].pos == pos; });
+        }
+
+        void run() {
+            outbox.assign(_search._workers.size(), nullptr);
+            int since_flush = 0;
+            while (!_search._done.load()) {
+                receive();
+                node* pn0 = front.pop();
+                if (pn0 == nullptr) {
+                    flush();
+                    wait();
+                    continue;
+                }
+                pn0->in_front = false;
+                //  can't lead to a better solution than the incumbent one
+                if (pn0->total_cost() >= _search._best_cost.load(std::memory_order_relaxed)) continue;
+
+                if (_search._problem.is_target(pn0->pos)) {
+                    _search.update_solution(pn0->pos, pn0->cost_from_src);
+                    continue;
+                }
+
+                expand(pn0);
+                if (++since_flush == FLUSH_PERIOD) {
+                    flush();
+                    since_flush = 0;
+                }
+            }
+        }
+
+        void expand(node* pn0) {
+            num_expanded++;
+            moves.clear();
+            _search._problem.get_moves(pn0->pos, moves);
+            for (const auto& move : moves) {
+                _search._problem.apply_move(pn0->pos, move, succ);
+                const float cost_from_src = pn0->cost_from_src + _search._problem.get_cost(pn0->pos, move);
+                const size_t hash = position_hash(succ);
+                const int dst = _search.owner(hash);
+                if (dst == _id) {
+                    add(succ, move, cost_from_src, hash);
+                    continue;
+                }
+                batch*& b = outbox[dst];
+                if (b == nullptr) {
+                    b = new batch;
+                    b->size = 0;
+                }
+                b->items[b->size++] = { succ, move, cost_from_src };
+                if (b->size == BATCH_SIZE) send(dst);
+            }
+        }
+
+        //  adds the node reached with the given cost, or updates the visited one
+        void add(const TPos& pos, const TMove& move, float cost_from_src, size_t hash) {
+            const uint32_t k = closed_table::key(hash);
+            const uint32_t idx = find_node(k, pos);
+            if (idx == closed_table::NONE) {
+                const uint32_t idx_new = nodes.allocate();
+                node* pnew = &nodes[idx_new];
+                pnew->pos           = pos;
+                pnew->move          = move;
+                pnew->cost_from_src = cost_from_src;
+                pnew->cost_to_dst   = _search._problem.estimate_cost(pos);
+                pnew->in_front      = true;
+                front.push(pnew);
+                visited.insert(k, idx_new);
+                return;
+            }
+            node* pn = &nodes[idx];
+            if (pn->cost_from_src > cost_from_src) {
+                //  a better path: update the node, reopening it if it had been expanded
+                if (pn->in_front) front.erase(pn);
+                pn->cost_from_src   = cost_from_src;
+                pn->move            = move;
+                pn->in_front        = true;
+                front.push(pn);
+            }
+        }
+
+        void send(int dst) {
+            batch* b = outbox[dst];
+            outbox[dst] = nullptr;
+            num_sent += b->size;
+            //  in flight until the receiver has added the items
+            _search._pending.fetch_add(1);
+            worker& w = *_search._workers[dst];
+            b->next = w.inbox.load();
+            while (!w.inbox.compare_exchange_weak(b->next, b)) {}
+            w.notify();
+        }
+
+        void notify() {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            wake.notify_one();
+        }
+
+        void flush() {
+            const int nworkers = (int)outbox.size();
+            for (int i = 0; i < nworkers; i++) {
+                if (outbox[i]) send(i);
+            }
+        }
+
+        void receive() {
+            batch* b = inbox.exchange(nullptr);
+            if (b == nullptr) return;
+            if (idle) {
+                //  busy again before the received batches stop being in flight
+                idle = false;
+                _search._pending.fetch_add(1);
+            }
+            while (b) {
+                for (int i = 0; i < b->size; i++) {
+                    const message& m = b->items[i];
+                    add(m.pos, m.move, m.cost_from_src, position_hash(m.pos));
+                }
+                _search._pending.fetch_sub(1);
+                batch* next = b->next;
+                delete b;
+                b = next;
+            }
+        }
+
+        //  nothing to expand (and the batches flushed): the search is over if this thread
+        //  was the last busy one with no batches in flight, otherwise sleeps until a batch
+        //  is sent here
+        void wait() {
+            if (!idle) {
+                idle = true;
+                if (_search._pending.fetch_sub(1) == 1) {
+                    _search.finish();
+                    return;
+                }
+            }
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            wake.wait(lock, [this] { return inbox.load() != nullptr || _search._done.load(); });
+        }
+    };
+
+    const TProblem&                         _problem;       //  reference to the problem
+    TPos                                    _source;        //  starting position
+    TPos                                    _found_target;  //  the best target position found
+    bool                                    _has_solution;  //  whether a solution has been found
+    std::mutex                              _solution_mutex;
+    std::atomic<float>                      _best_cost;     //  cost of the incumbent solution
+
+    std::vector<std::unique_ptr<worker>>    _workers;
+    std::atomic<int64_t>                    _pending;       //  number of the busy threads plus the batches in flight
+    std::atomic<bool>                       _done;
+
+    inline int owner(size_t hash) const {
+        //  the upper bits of the key, while the closed tables use the lower ones
+        return (int)(((uint64_t)closed_table::key(hash)*_workers.size()) >> 32);
+    }
+
+    void finish() {
+        _done.store(true);
+        for (auto& w : _workers) {
+            std::lock_guard<std::mutex> lock(w->wake_mutex);
+            w->wake.notify_all();
+        }
+    }
+
+    void update_solution(const TPos& pos, float cost) {
+        std::lock_guard<std::mutex> lock(_solution_mutex);
+        if (cost < _best_cost.load()) {
+            _found_target = pos;
+            _has_solution = true;
+            _best_cost.store(cost);
+        }
+    }
+};
+
+#endif // __HDASTAR__
@@ -0,0 +1,153 @@
+#ifndef __IDASTAR__
+#define __IDASTAR__
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+
+#include "astar.hpp"
+#include "zobrist.hpp"
+
+//  Iterative deepening A*: a series of depth first searches, bounded by the total cost,
+//  the bound raised every iteration to the lowest total cost which exceeded it.
+//
+//  Uses the same problem interface as astar. The search works on a single position,
+//  which is modified in place by apply_move/unapply_move, so memory is proportional
+//  to the solution depth (the move lists are kept per depth and reused) rather than
+//  to the number of states. Positions repeating on the current path are skipped.
+//
+//  Optionally, a fixed-size transposition table (2^tt_bits entries, always replaced)
+//  prunes the positions already searched in the current iteration with no larger cost
+//  from source. The positions are identified by their 64-bit hashes there.
+template <typename TProblem, typename TPos = typename TProblem::position,
+    typename TMove = typename TProblem::move>
+class idastar {
+public:
+    idastar(const TProblem& problem, const TPos& source, int tt_bits = 0) :
+        _problem(problem), _source(source), _pos(source), _has_solution(false),
+        _done(false), _num_expanded(0), _num_iterations(0), _tt_shift(0) {
+        _bound = _problem.estimate_cost(_source);
+        if (tt_bits > 0) {
+            _tt.assign((size_t)1 << tt_bits, tt_entry{ 0, 0.0f, 0 });
+            _tt_shift = 64 - tt_bits;
+        }
+    }
+
+    //  runs a single iteration, returns true when the search is over
+    bool step() {
+        if (_done) return true;
+        _num_iterations++;
+        _next_bound = INF;
+        _path.clear();
+        _hashes.clear();
+        _pos = _source;
+        if (search(0.0f, _problem.estimate_cost(_source))) {
+            _has_solution = true;
+            _done = true;
+        } else if (_next_bound == INF) {
+            //  nothing exceeded the bound, the search space is exhausted
+            _done = true;
+        } else {
+            _bound = _next_bound;
+        }
+        return _done;
+    }
+
+    void solve() {
+        while (!step()) {
+        }
+    }
+
+    bool get_solution(std::vector<TMove>& res) const {
+        if (!_has_solution) return false;
+        res = _path;
+        resolve_moves(_problem, _source, res, 0);
+        return true;
+    }
+
+    //  total cost bound of the current (or the last) iteration
+    float bound() const { return _bound; }
+    uint64_t num_expanded() const { return _num_expanded; }
+    uint32_t num_iterations() const { return _num_iterations; }
+
+private:
+    struct tt_entry {
+        uint64_t    hash;           //  position hash
+        float       cost_from_src;  //  lowest cost from source the position was searched with
+        uint32_t    iteration;      //  iteration the entry belongs to, 0 if empty
+    };
+
+    static constexpr float INF = std::numeric_limits<float>::max();
+    //  slack for the accumulated float costs
+    static constexpr float EPS = 1e-4f;
+
+    const TProblem&                 _problem;       //  reference to the problem
+    TPos                            _source;        //  starting position
+    TPos                            _pos;           //  current position of the search
+    bool                            _has_solution;  //  whether the solution has been found
+    bool                            _done;          //  whether the search is over
+
+    float                           _bound;         //  total cost bound of the iteration
+    float                           _next_bound;    //  lowest total cost exceeding the bound
+    uint64_t                        _num_expanded;  //  number of positions expanded, total
+    uint32_t                        _num_iterations;
+
+    std::vector<TMove>              _path;          //  moves from the source to _pos
+    std::vector<uint64_t>           _hashes;        //  hashes of the positions on the path
+    std::vector<std::vector<TMove>> _moves;         //  moves containers, per depth
+
+    std::vector<tt_entry>           _tt;            //  transposition table, if any
+    int                             _tt_shift;      //  64 - log2 of the table size
+
+    //  searches from _pos, which has the given costs;
+    //  returns true if the target is found (_path leads to it then)
+    bool search(float cost_from_src, float cost_to_dst) {
+        const float total_cost = cost_from_src + cost_to_dst;
+        if (total_cost > _bound + EPS) {
+            _next_bound = std::min(_next_bound, total_cost);
+            return false;
+        }
+        if (_problem.is_target(_pos)) return true;
+
+        const uint64_t hash = position_hash(_pos);
+        if (!_tt.empty() && !tt_update(hash, cost_from_src)) return false;
+        _num_expanded++;
+
+        const size_t depth = _path.size();
+        if (_moves.size() <= depth) _moves.resize(depth + 1);
+        _moves[depth].clear();
+        _problem.get_moves(_pos, _moves[depth]);
+        _hashes.push_back(hash);
+
+        //  the moves container may get reallocated by the deeper searches, so is indexed
+        const size_t nmoves = _moves[depth].size();
+        for (size_t i = 0; i < nmoves; i++) {
+            const TMove move = _moves[depth][i];
+            const float cost = _problem.get_cost(_pos, move);
+            _problem.apply_move(_pos, move, _pos);
+            if (std::find(_hashes.begin(), _hashes.end(), (uint64_t)position_hash(_pos)) ==
+                _hashes.end()) {
+                _path.push_back(move);
+                if (search(cost_from_src + cost, _problem.estimate_cost(_pos))) return true;
+                _path.pop_back();
+            }
+            _problem.unapply_move(_pos, move, _pos);
+        }
+
+        _hashes.pop_back();
+        return false;
+    }
+
+    //  returns false if the position has been already searched in this iteration
+    //  with no larger cost from source, registers it otherwise
+    bool tt_update(uint64_t hash, float cost_from_src) {
+        tt_entry& e = _tt[(size_t)((hash*0x9E3779B97F4A7C15ull) >> _tt_shift)];
+        if (e.iteration == _num_iterations && e.hash == hash &&
+            e.cost_from_src <= cost_from_src + EPS) return false;
+        e = { hash, cost_from_src, _num_iterations };
+        return true;
+    }
+};
+
+#endif // __IDASTAR__
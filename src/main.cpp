@@ -12,18 +12,299 @@
 #include <queue>
 #include <unordered_set>
 #include <chrono>
+#include <limits>
 
 #include "cmd_param.hpp"
 
 #include "sliding_puzzle.hpp"
 #include "sliding_puzzle_svg.hpp"
+#include "idastar.hpp"
+#include "hdastar.hpp"
+#include "bidirectional.hpp"
+#include "arastar.hpp"
+#include "external_search.hpp"
 
 
+struct solver_options {
+    std::string name              = "astar";  //  astar, idastar, hdastar, bidirectional, arastar or external
+    int         tt_bits           = 0;        //  IDA* transposition table size (log2), 0 if none
+    int         num_threads       = 0;        //  HDA* threads, 0 for all the hardware threads
+    float       weight            = 3.0f;     //  ARA* initial heuristic weight
+    float       weight_step       = 0.5f;     //  ARA* weight decrement
+    double      time_limit        = 0.0;      //  ARA* and A* time budget (seconds), 0 for none
+    std::string temp_dir          = ".";      //  external search layer files directory
+    size_t      memory            = 256;      //  external search memory limit (MB)
+    std::string checkpoint;                   //  A* checkpoint file, to resume from and to save to
+    double      checkpoint_period = 0.0;      //  A* checkpoint saving period (seconds), 0 for when stopped
+    uint64_t    max_expansions    = 0;        //  A* expansion budget, 0 for none
+    uint64_t    max_memory        = 0;        //  A* memory budget (MB), 0 for none
+    uint64_t    progress          = 0;        //  A* progress report period (expansions), 0 for none
+    bool        stats             = false;    //  A* search statistics, with the phase timing
+
+    bool budgeted() const {
+        return !checkpoint.empty() || time_limit > 0.0 || max_expansions > 0 || max_memory > 0;
+    }
+};
+
+template <typename TPos>
+bool solve_idastar(const sliding_puzzle& sp, int tt_bits, std::vector<sliding_puzzle::move>& solution) {
+    idastar<sliding_puzzle, TPos> solver(sp, sp.get_source<TPos>(), tt_bits);
+    solver.solve();
+
+    std::cout << "Expanded positions: " << solver.num_expanded() << 
+        " (iterations: " << solver.num_iterations() << ")\n";
+    return solver.get_solution(solution);
+}
+
+template <typename TPos>
+bool solve_hdastar(const sliding_puzzle& sp, int num_threads, std::vector<sliding_puzzle::move>& solution) {
+    hdastar<sliding_puzzle, TPos> solver(sp, sp.get_source<TPos>(), num_threads);
+    solver.solve();
+
+    std::cout << "Visited positions: " << solver.num_visited() << 
+        " (threads: " << solver.num_threads() << ", expanded: " << solver.num_expanded() << 
+        ", sent: " << solver.num_sent() << ")\n";
+    return solver.get_solution(solution);
+}
+
+template <typename TPos>
+bool solve_bidirectional(const sliding_puzzle& sp, std::vector<sliding_puzzle::move>& solution) {
+    bidirectional<sliding_puzzle, TPos> solver(sp, sp.get_source<TPos>());
+    if (!solver.is_bidirectional()) std::cout << "The target is partial, searching from the source only\n";
+    solver.solve();
+
+    std::cout << "Visited positions: " << solver.num_visited() << "\n";
+    return solver.get_solution(solution);
+}
+
+//  reports every improved solution, stops improving once out of the time budget
+template <typename TPos>
+bool solve_arastar(const sliding_puzzle& sp, const solver_options& opt, 
+    std::vector<sliding_puzzle::move>& solution) {
+    using namespace std::chrono;
+    const auto start = steady_clock::now();
+    arastar<sliding_puzzle, TPos> solver(sp, sp.get_source<TPos>(), opt.weight, opt.weight_step);
+    float cost = std::numeric_limits<float>::max();
+    while (solver.improve()) {
+        const double elapsed = duration<double>(steady_clock::now() - start).count();
+        if (solver.has_solution() && solver.solution_cost() < cost) {
+            cost = solver.solution_cost();
+            std::cout << "Solution: " << cost << " moves (weight: " << solver.weight() << 
+                ", suboptimality bound: " << solver.bound() << ", " << elapsed << " seconds)\n";
+        }
+        if (opt.time_limit > 0.0 && elapsed >= opt.time_limit) break;
+    }
+
+    std::cout << "Visited positions: " << solver.num_visited() << 
+        " (suboptimality bound: " << solver.bound() << ")\n";
+    return solver.get_solution(solution);
+}
+
+//  the layers on disk, as long as the positions can be stored as they are
+template <typename TPos>
+bool solve_external(const sliding_puzzle& sp, const solver_options& opt, 
+    std::vector<sliding_puzzle::move>& solution, std::true_type) {
+    external_search<sliding_puzzle, TPos> solver(sp, sp.get_source<TPos>(), opt.temp_dir, opt.memory << 20);
+    solver.solve();
+    if (solver.failed()) {
+        std::cerr << "Could not write the layer files to: '" << opt.temp_dir << "'\n";
+        return false;
+    }
+
+    std::cout << "Visited positions: " << solver.num_visited() << 
+        " (layers: " << solver.depth() + 1 << ", sorted runs: " << solver.num_runs() << 
+        ", bytes written: " << solver.bytes_written() << ")\n";
+    return solver.get_solution(solution);
+}
+
+template <typename TPos>
+bool solve_external(const sliding_puzzle&, const solver_options&, 
+    std::vector<sliding_puzzle::move>&, std::false_type) {
+    std::cerr << "The external search supports up to 32 pieces\n";
+    return false;
+}
+
+static const char* status_str(search_status status) {
+    switch (status) {
+    case search_status::solved:             return "solved";
+    case search_status::no_solution:        return "no solution";
+    case search_status::expansion_limit:    return "out of the expansion budget";
+    case search_status::time_limit:         return "out of time";
+    case search_status::memory_limit:       return "out of the memory budget";
+    }
+    return "";
+}
+
+//  resumes the search from the checkpoint if there is one, runs it in the slices of 
+//  the checkpoint period (saving the checkpoint after every one) until done or out of the budget,
+//  saves the checkpoint if stopped, removes it if done
+template <typename TSolver>
+bool solve_budgeted(TSolver& solver, const solver_options& opt, bool& resumed) {
+    using namespace std::chrono;
+    resumed = false;
+    if (!opt.checkpoint.empty()) {
+        if (solver.load(opt.checkpoint)) {
+            resumed = true;
+            std::cout << "Resumed from the checkpoint: " << solver.num_visited() << " visited positions, " << 
+                solver.num_expanded() << " expanded\n";
+        } else if (std::ifstream(opt.checkpoint).good()) {
+            std::cerr << "The checkpoint '" << opt.checkpoint << "' is not of this puzzle and heuristic (or is unreadable), starting afresh\n";
+        }
+    }
+
+    const auto start = steady_clock::now();
+    const uint64_t expanded = solver.num_expanded();
+    search_status status;
+    while (true) {
+        search_limits limits;
+        limits.max_bytes = opt.max_memory << 20;
+        if (opt.max_expansions > 0) {
+            const uint64_t done = solver.num_expanded() - expanded;
+            if (done >= opt.max_expansions) {
+                status = search_status::expansion_limit;
+                break;
+            }
+            limits.max_expansions = opt.max_expansions - done;
+        }
+        const double elapsed = duration<double>(steady_clock::now() - start).count();
+        if (opt.time_limit > 0.0 && elapsed >= opt.time_limit) {
+            status = search_status::time_limit;
+            break;
+        }
+        limits.max_seconds = opt.time_limit > 0.0 ? opt.time_limit - elapsed : 0.0;
+        const bool sliced = !opt.checkpoint.empty() && opt.checkpoint_period > 0.0 &&
+            (limits.max_seconds == 0.0 || opt.checkpoint_period < limits.max_seconds);
+        if (sliced) limits.max_seconds = opt.checkpoint_period;
+
+        status = solver.solve(limits);
+        if (!sliced || status != search_status::time_limit) break;
+        if (!solver.save(opt.checkpoint)) {
+            std::cerr << "Could not write the checkpoint: '" << opt.checkpoint << "'\n";
+        }
+    }
+
+    std::cout << "Search status: " << status_str(status) << "\n";
+    if (status == search_status::solved || status == search_status::no_solution) {
+        if (!opt.checkpoint.empty()) std::remove(opt.checkpoint.c_str());
+        return status == search_status::solved;
+    }
+    if (!opt.checkpoint.empty()) {
+        if (solver.save(opt.checkpoint)) {
+            std::cout << "Checkpoint saved to: '" << opt.checkpoint << "'\n";
+        } else {
+            std::cerr << "Could not write the checkpoint: '" << opt.checkpoint << "'\n";
+        }
+    }
+    return false;
+}
+
+static void print_stats(const search_stats& stats, bool phases) {
+    std::cout << "Expanded: " << stats.expanded << ", generated: " << stats.generated << 
+        ", duplicates: " << stats.duplicates << ", updated: " << stats.updated << 
+        ", reopened: " << stats.reopened << ", f: " << stats.max_f << 
+        ", front: " << stats.front_size << ", visited: " << stats.visited << 
+        ", memory: " << (stats.bytes >> 20) << " MB, " << stats.seconds << " seconds\n";
+    if (!phases) return;
+    static const char* names[] = { "moves", "heuristic", "hashing", "queue" };
+    std::cout << "Phase time:";
+    for (int i = 0; i < (int)search_phase::count; i++) {
+        std::cout << " " << names[i] << " " << stats.phase_seconds[i] << "s";
+    }
+    std::cout << "\n";
+}
+
+static void report_progress(null_observer&, const solver_options&) {}
+
+template <bool PhaseTimers>
+void report_progress(stats_observer<PhaseTimers>& observer, const solver_options& opt) {
+    observer.set_progress(opt.progress, [](const search_stats& stats) { print_stats(stats, false); });
+}
+
+static void report_stats(const null_observer&) {}
+
+template <bool PhaseTimers>
+void report_stats(const stats_observer<PhaseTimers>& observer) {
+    print_stats(observer.stats(), PhaseTimers);
+}
+
+//  the observer collects the statistics if reporting them, otherwise it compiles to nothing
+template <typename TPos, typename TObserver>
+bool solve_astar(const sliding_puzzle& sp, const solver_options& opt, 
+    std::vector<sliding_puzzle::move>& solution, bool& resumed) {
+    astar<sliding_puzzle, TPos, sliding_puzzle::move, bucket_queue_policy<>, TObserver> solver(
+        sp, sp.get_source<TPos>());
+    report_progress(solver.observer(), opt);
+    if (opt.budgeted()) {
+        const bool solved = solve_budgeted(solver, opt, resumed);
+        report_stats(solver.observer());
+        std::cout << "Visited positions: " << solver.num_visited() << 
+            " (expanded: " << solver.num_expanded() << ", memory: " << (solver.bytes() >> 20) << " MB)\n";
+        return solved && solver.get_solution(solution);
+    }
+    solver.solve();
+    report_stats(solver.observer());
+
+    const auto& stats = solver.visited_stats();
+    std::cout << "Visited positions: " << solver.num_visited() << 
+        " (load factor: " << solver.visited_load_factor() << 
+        ", avg probes: " << stats.avg_probes() << 
+        ", hash collision rate: " << stats.collision_rate() << ")\n";
+    return solver.get_solution(solution);
+}
+
+//  resumed tells if A* was resumed from a checkpoint
+template <typename TPos>
+bool solve(const sliding_puzzle& sp, const solver_options& opt, 
+    std::vector<sliding_puzzle::move>& solution, bool& resumed) {
+    resumed = false;
+    if (opt.name == "idastar") return solve_idastar<TPos>(sp, opt.tt_bits, solution);
+    if (opt.name == "hdastar") return solve_hdastar<TPos>(sp, opt.num_threads, solution);
+    if (opt.name == "bidirectional") return solve_bidirectional<TPos>(sp, solution);
+    if (opt.name == "arastar") return solve_arastar<TPos>(sp, opt, solution);
+    if (opt.name == "external") {
+        return solve_external<TPos>(sp, opt, solution, std::is_trivially_copyable<TPos>());
+    }
+
+    //  the phase timing takes a few clock reads per expansion
+    if (opt.stats) return solve_astar<TPos, stats_observer<true>>(sp, opt, solution, resumed);
+    if (opt.progress > 0) return solve_astar<TPos, stats_observer<false>>(sp, opt, solution, resumed);
+    return solve_astar<TPos, null_observer>(sp, opt, solution, resumed);
+}
 
 int main(int argc, char *argv[]) { 
-    if (argc < 2) {
-        std::cout << "Usage: " << argv[0] << " <puzzle layout file> [--svg=svg_path] "
-            "[--cw=CELL_WIDTH] [--ch=CELL_HEIGHT] [--columns=COLUMNS] [--colormap=COLORMAP]\n";
+    if (argc < 2 || std::string(argv[1]) == "--help") {
+        std::cout << "Usage: " << argv[0] << " <puzzle layout file> [options]\n"
+            "  --svg=SVG_PATH [--cw=CELL_WIDTH] [--ch=CELL_HEIGHT] [--columns=COLUMNS] [--colormap=COLORMAP]\n"
+            "      draws the solution\n"
+            "  --heuristic=admissible|weighted, --weight=WEIGHT\n"
+            "      the admissible heuristic guarantees optimal solutions, the weighted one (the default)\n"
+            "      scales the Manhattan distance by WEIGHT (0.5 by default)\n"
+            "  --pdb_dir=PDB_CACHE_DIR, --pdb_size=MAX_PDB_ENTRIES\n"
+            "      pattern databases: exact distances of the target pieces with a few blockers,\n"
+            "      cached in the directory between the runs\n"
+            "  --solver=astar|idastar|hdastar|bidirectional|arastar|external\n"
+            "      idastar: IDA*, --tt_bits=N for a transposition table of 2^N entries\n"
+            "      hdastar: hash distributed parallel A* on --threads=THREADS (all the hardware ones\n"
+            "          by default), optimal with the admissible heuristic\n"
+            "      bidirectional: searches from the target as well if it lays out all the pieces\n"
+            "      arastar: anytime repairing A*, the admissible heuristic weighted by --weight (3 by\n"
+            "          default) lowered by --weight_step=STEP (0.5) after every solution, until optimal\n"
+            "          or out of --time_limit\n"
+            "      external: breadth first search with the layers in sorted files in --temp_dir=DIR,\n"
+            "          sorting in --memory=MEGABYTES (256 by default)\n"
+            "  --max_expansions=EXPANSIONS, --time_limit=SECONDS, --max_memory=MEGABYTES\n"
+            "      the A* budget\n"
+            "  --checkpoint=CHECKPOINT_FILE, --checkpoint_period=SECONDS\n"
+            "      A* stopped by the budget saves its state to the file (and periodically, if given),\n"
+            "      the next run with the same puzzle, heuristic and file resumes from it\n"
+            "  --progress=EXPANSIONS, --stats\n"
+            "      reports the A* statistics every given number of expansions, and at the end\n"
+            "      with the time spent per search phase\n"
+            "  --solution_cache=DIR\n"
+            "      keeps the exact distances of the positions on the optimal solutions in a file per\n"
+            "      board, used as the heuristic and to stop at the positions solved before\n"
+            "  --huge_pages=none|advise|reserved\n"
+            "      the huge pages backing the search nodes (the transparent ones advised by default)\n";
         return 1;
     }
 
@@ -36,26 +317,117 @@ int main(int argc, char *argv[]) {
     }
 
     sliding_puzzle sp;
-    sp.parse(fs);
+    std::string error;
+    if (!sp.parse(fs, error)) {
+        std::cerr << "Could not parse the puzzle '" << path << "': " << error << "\n";
+        return 1;
+    }
     fs.close();
 
-    //  solve the puzzle
-    astar<sliding_puzzle> solver(sp, sp.get_source());
-    
+    cmd_param param(argc, argv);
+    std::string heuristic;
+    float weight = 0.5f;
+    param.get("heuristic", heuristic);
+    const bool has_weight = param.get("weight", weight);
+
+    //  IDA* uses memory proportional to the solution depth only (plus the optional 
+    //  transposition table), at the expense of re-expanding the positions;
+    //  HDA* distributes the positions between the threads by their hashes;
+    //  the bidirectional search needs the target to specify all the pieces;
+    //  ARA* weights the admissible heuristic itself, starting from --weight;
+    //  the external search keeps the breadth first search layers in files;
+    //  A* can be stopped by the budget and resumed from the checkpoint, and can report
+    //  its progress and statistics
+    solver_options opt;
+    param.get("solver", opt.name);
+    param.get("tt_bits", opt.tt_bits);
+    param.get("threads", opt.num_threads);
+    param.get("weight_step", opt.weight_step);
+    param.get("time_limit", opt.time_limit);
+    param.get("temp_dir", opt.temp_dir);
+    param.get("memory", opt.memory);
+    param.get("checkpoint", opt.checkpoint);
+    param.get("checkpoint_period", opt.checkpoint_period);
+    param.get("max_expansions", opt.max_expansions);
+    param.get("max_memory", opt.max_memory);
+    param.get("progress", opt.progress);
+    opt.stats = param.get("stats", opt.stats);
+
+    //  the search nodes are in the transparent huge pages by default
+    std::string huge;
+    if (param.get("huge_pages", huge)) {
+        page_memory::set_huge_pages(huge == "none" ? huge_pages::none :
+            huge == "reserved" ? huge_pages::reserved : huge_pages::advise);
+    }
+    if (opt.name == "arastar") {
+        if (has_weight) opt.weight = weight;
+        heuristic = "admissible";
+    }
+
+    sp.set_heuristic(heuristic == "admissible" ? 
+        sliding_puzzle::heuristic::admissible : sliding_puzzle::heuristic::weighted, weight);
+
+    //  pattern databases, cached in the given directory
+    std::string pdb_dir;
+    uint64_t pdb_size = sliding_puzzle::DEFAULT_PDB_ENTRIES;
+    const bool has_pdb_dir = param.get("pdb_dir", pdb_dir);
+    if (param.get("pdb_size", pdb_size) || has_pdb_dir) {
+        sp.add_pattern_dbs(pdb_dir, pdb_size);
+        for (const auto& pdb : sp.pattern_dbs()) {
+            std::cout << "Pattern database: " << pdb->pieces().size() << " pieces, " << 
+                pdb->size() << " entries (" << (pdb->is_mapped() ? "loaded" : "built") << ")\n";
+        }
+    }
+
+    //  solved positions of the board, cached in the given directory
+    std::string solutions_path;
+    std::shared_ptr<solution_cache> solutions;
+    if (param.get("solution_cache", solutions_path)) {
+        solutions = std::make_shared<solution_cache>(sp.board_key());
+        solutions_path = solution_cache::file_name(solutions_path, solutions->key());
+        if (!solutions->load(solutions_path) && std::ifstream(solutions_path).good()) {
+            std::cerr << "The solution cache '" << solutions_path << "' is of an earlier version (or is unreadable), starting afresh\n";
+        }
+        sp.set_solution_cache(solutions);
+        std::cout << "Solution cache: " << solutions->size() << " positions\n";
+    }
+
+    //  solve the puzzle, using the smallest inline position type that fits the pieces
     using namespace std::chrono;
     auto start = system_clock::now();
-    solver.solve();
 
-    //  print the result
     std::vector<sliding_puzzle::move> solution;
-    bool solved = solver.get_solution(solution);
+    const int npieces = sp.num_pieces();
+    bool solved = false;
+    bool resumed = false;
+    if (npieces <= 8) {
+        solved = solve<sliding_puzzle::fixed_position<8>>(sp, opt, solution, resumed);
+    } else if (npieces <= 16) {
+        solved = solve<sliding_puzzle::fixed_position<16>>(sp, opt, solution, resumed);
+    } else if (npieces <= 32) {
+        solved = solve<sliding_puzzle::fixed_position<32>>(sp, opt, solution, resumed);
+    } else {
+        solved = solve<sliding_puzzle::position>(sp, opt, solution, resumed);
+    }
+
+    //  only the solutions guaranteed optimal give the exact distances: not the ones of 
+    //  the searches resumed from a checkpoint, whose nodes may come from another search
+    const bool optimal = opt.name == "external" || (heuristic == "admissible" && !resumed &&
+        (opt.name == "astar" || opt.name == "idastar" || opt.name == "hdastar"));
+    if (solutions && solved && optimal) {
+        sp.record_solution(*solutions, solution);
+        if (!solutions->save(solutions_path)) {
+            std::cerr << "Could not write the solution cache: '" << solutions_path << "'\n";
+        }
+    }
+
+    //  print the result
     std::cout << "Moves: " << sliding_puzzle::moves_str(solution) << 
         "\n(total of " << solution.size() << ")\nElapsed time: " << 
-        duration_cast<seconds>(system_clock::now() - start).count() << " seconds\n" << std::endl;
+        duration<double>(system_clock::now() - start).count() << " seconds\n" << std::endl;
 
     //  generate svg
     std::string svg_path;
-    cmd_param param(argc, argv);
     if (param.get("svg", svg_path)) {
 
         sliding_puzzle_svg svg;
@@ -70,7 +442,7 @@ int main(int argc, char *argv[]) {
             return 1;
         }
 
-        svg.gen_solution(svg_fs, sp, sp.get_source(), solution);
+        svg.gen_solution(svg_fs, sp, sp.get_layout(), solution);
         svg_fs.close();
     }
 
@@ -0,0 +1,87 @@
+#ifndef __MAPPED_FILE__
+#define __MAPPED_FILE__
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//  read-only memory-mapped file
+class mapped_file {
+public:
+    mapped_file() : _data(nullptr), _size(0) {}
+
+    ~mapped_file() {
+        close();
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator =(const mapped_file&) = delete;
+
+    //  maps the whole file, fails for the empty files as well
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER file_size;
+        HANDLE mapping = NULL;
+        if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        }
+        CloseHandle(file);
+        if (mapping == NULL) return false;
+        void* map = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (map == NULL) return false;
+        const size_t size = (size_t)file_size.QuadPart;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        void* map = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (map == MAP_FAILED) return false;
+        const size_t size = (size_t)st.st_size;
+#endif
+        _data = (const uint8_t*)map;
+        _size = size;
+        return true;
+    }
+
+    void close() {
+        if (!_data) return;
+#ifdef _WIN32
+        UnmapViewOfFile((void*)_data);
+#else
+        munmap((void*)_data, _size);
+#endif
+        _data = nullptr;
+        _size = 0;
+    }
+
+    bool is_open() const { return _data != nullptr; }
+    const uint8_t* data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    const uint8_t*  _data;  //  mapped view
+    size_t          _size;  //  file size, bytes
+};
+
+#endif // __MAPPED_FILE__
@@ -0,0 +1,127 @@
+#ifndef __NODE_ARENA__
+#define __NODE_ARENA__
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "page_memory.hpp"
+
+//  append-only element arena, addressed by 32-bit indices.
+//  Elements are stored in the chunks of page memory (see page_memory.hpp) growing
+//  geometrically: the first two of 2^ChunkBits elements, every next one twice the previous,
+//  so pointers to them stay valid, index lookup is a bit scan, a shift and a mask, and
+//  the memory only gets touched as the arena grows (the large chunks in the huge pages).
+//  An arena is not thread-safe, the parallel searches keep one per thread
+template <typename TElem, int ChunkBits = 12>
+class node_arena {
+public:
+    static constexpr uint32_t CHUNK_SIZE = 1u << ChunkBits;
+
+    node_arena() : _size(0), _capacity(0), _num_chunks(0), _bytes(0) {}
+
+    ~node_arena() {
+        clear();
+    }
+
+    node_arena(const node_arena&) = delete;
+    node_arena& operator =(const node_arena&) = delete;
+
+    uint32_t allocate() {
+        if (_size == _capacity) add_chunk();
+        new (&(*this)[_size]) TElem();
+        return _size++;
+    }
+
+    inline TElem& operator [](uint32_t idx) {
+        const int c = chunk_index(idx);
+        return _chunks[c].mem[idx & chunk_mask(c)];
+    }
+
+    inline const TElem& operator [](uint32_t idx) const {
+        const int c = chunk_index(idx);
+        return _chunks[c].mem[idx & chunk_mask(c)];
+    }
+
+    //  destroys all the elements, releasing the memory
+    void clear() {
+        destroy();
+        for (int c = 0; c < _num_chunks; c++) page_memory::free(_chunks[c].mem, _chunks[c].bytes);
+        _num_chunks = 0;
+        _capacity = 0;
+        _bytes = 0;
+    }
+
+    //  destroys all the elements, keeping the memory for reuse
+    //  (constant time for the trivially destructible elements)
+    void reset() {
+        destroy();
+    }
+
+    uint32_t size() const { return _size; }
+    //  number of the elements the allocated chunks fit
+    uint64_t capacity() const { return _capacity; }
+    double occupancy() const { return _capacity ? (double)_size/_capacity : 0.0; }
+
+    //  total allocated memory, bytes
+    uint64_t bytes() const { return _bytes; }
+
+private:
+    static constexpr int MAX_CHUNKS = 32 - ChunkBits + 1;
+
+    struct chunk {
+        TElem*  mem;
+        size_t  bytes;      //  mapped size
+    };
+
+    chunk       _chunks[MAX_CHUNKS];
+    uint32_t    _size;          //  number of allocated elements
+    uint64_t    _capacity;      //  number of elements in the chunks
+    int         _num_chunks;
+    uint64_t    _bytes;         //  mapped size of the chunks
+
+    //  0 for the first chunk, then the bit width of idx >> ChunkBits
+    static inline int chunk_index(uint32_t idx) {
+        const uint32_t hi = idx >> ChunkBits;
+        if (hi == 0) return 0;
+#ifdef _MSC_VER
+        unsigned long bit;
+        _BitScanReverse(&bit, hi);
+        return (int)bit + 1;
+#else
+        return 32 - __builtin_clz(hi);
+#endif
+    }
+
+    //  the chunks 0 and 1 have 2^ChunkBits elements, the chunk c > 1 has 2^(ChunkBits + c - 1)
+    static inline uint32_t chunk_mask(int c) {
+        return (CHUNK_SIZE << (c - (c != 0))) - 1;
+    }
+
+    void add_chunk() {
+        const int c = _num_chunks;
+        if (c == MAX_CHUNKS) throw std::bad_alloc();
+        const size_t count = (size_t)chunk_mask(c) + 1;
+        size_t bytes = count*sizeof(TElem);
+        TElem* mem = (TElem*)page_memory::allocate(bytes);
+        if (!mem) throw std::bad_alloc();
+        _chunks[c] = { mem, bytes };
+        _num_chunks++;
+        _capacity += count;
+        _bytes += bytes;
+    }
+
+    void destroy() {
+        if (!std::is_trivially_destructible<TElem>::value) {
+            for (uint32_t i = 0; i < _size; i++) (*this)[i].~TElem();
+        }
+        _size = 0;
+    }
+};
+
+#endif // __NODE_ARENA__
@@ -2,6 +2,14 @@
 #define __NPUZZLE__
 
 #include <array>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+
+#include "zobrist.hpp"
+#include "npuzzle_pdb.hpp"
+#include "cpu_features.hpp"
 
 
 template <int N = 3, int M = N>
@@ -9,28 +17,82 @@ class npuzzle {
 public:
     typedef std::array<int8_t, N*M> cell_arr;
     typedef int16_t move;
+    typedef npuzzle_pdb<N, M> pattern_db;
+
+    //  heuristic modes (all admissible):
+    //      manhattan       - sum of the tile Manhattan distances
+    //      linear_conflict - Manhattan distance plus two moves for every tile which has 
+    //                        to leave its target row/column to let the others pass
+    //      pattern_db      - additive disjoint pattern databases (see npuzzle_pdb), 
+    //                        or the linear conflict one if it is larger
+    enum class heuristic { manhattan, linear_conflict, pattern_db };
+
+    //  the costs are whole moves (the search nodes keep them as 16-bit integers, see astar)
+    static constexpr int cost_scale = 1;
+
+    npuzzle() : _heuristic(heuristic::linear_conflict) {}
+
+    void set_heuristic(heuristic mode) {
+        _heuristic = mode;
+    }
+
+    //  sets the pattern databases (either generated or loaded) and switches to using them
+    void set_pattern_db(std::shared_ptr<const pattern_db> pdb) {
+        _pdb = pdb;
+        _heuristic = heuristic::pattern_db;
+    }
+
+    //  Zobrist keys for every (cell, tile) pair, the blank is not hashed
+    static const uint64_t* zobrist_keys() {
+        static const std::vector<uint64_t> keys = [] {
+            std::vector<uint64_t> res;
+            zobrist_fill(res, N*M*N*M);
+            return res;
+        }();
+        return &keys[0];
+    }
+
+    //  Manhattan distance of every tile from every cell
+    static const uint8_t* manhattan_table() {
+        static const std::vector<uint8_t> table = [] {
+            std::vector<uint8_t> res(N*M*N*M, 0);
+            for (int t = 1; t < N*M; t++) {
+                for (int i = 0; i < N*M; i++) {
+                    res[t*N*M + i] = (uint8_t)(abs(i%N - (t - 1)%N) + abs(i/N - (t - 1)/N));
+                }
+            }
+            return res;
+        }();
+        return &table[0];
+    }
 
     struct position {
         cell_arr cells;
         int8_t   blank_pos;
+        int16_t  manhattan; //  incrementally updated Manhattan distance
+        uint64_t zobrist;   //  incrementally updated hash of the cells
 
         position(const int8_t* in_cells = nullptr) : 
-            blank_pos(-1) {
+            blank_pos(-1), manhattan(0), zobrist(0) {
             if (in_cells) {
                 std::copy(in_cells, in_cells + N*M, cells.begin());
                 blank_pos = std::find(cells.begin(), cells.end(), 0) - cells.begin();
             } else {
                 for (int i = 0; i < N*M; i++) cells[i] = i + 1;
                 cells[M*N - 1] = 0;
+                blank_pos = M*N - 1;
+            }
+            const uint64_t* keys = zobrist_keys();
+            const uint8_t* dist = manhattan_table();
+            for (int i = 0; i < N*M; i++) {
+                if (cells[i] == 0) continue;
+                zobrist ^= keys[i*N*M + cells[i]];
+                manhattan += dist[cells[i]*N*M + i];
             }
         }
 
         size_t operator () () const {
-            std::size_t res = 0;
-            for (auto& v : cells) {
-                res ^= v + 0x9e3779b9 + (res << 6) + (res >> 2);
-            }
-            return res;
+            return (size_t)zobrist;
         }
 
         bool operator == (const position& rhs) const {
@@ -52,18 +114,32 @@ public:
     }
 
     inline float estimate_cost(const position& source) const {
-        int res = 0;
-        for (int i = 0; i < N*M; i++) {
-            int vx = i%N;
-            int vy = i/N;
-            int v = source.cells[i];
-            if (v > 0) {
-                int tx = (v - 1) % N;
-                int ty = (v - 1) / N;
-                res += abs(vx - tx) + abs(vy - ty);
+        if (_heuristic == heuristic::manhattan) return source.manhattan;
+        int conflicts;
+        linear_conflicts(&source, 1, &conflicts, std::integral_constant<bool, N == 4 && M == 4>());
+        const int res = source.manhattan + conflicts;
+        if (_heuristic == heuristic::linear_conflict || !_pdb) return (float)res;
+        return (float)std::max(res, _pdb->estimate(source.cells));
+    }
+
+    //  the estimates of n positions at once, for the batched A* expansion: 
+    //  the linear conflicts of the 4x4 boards are counted by the SIMD kernels
+    void estimate_costs(const position* pos, size_t n, float* res) const {
+        if (_heuristic == heuristic::manhattan) {
+            for (size_t i = 0; i < n; i++) res[i] = pos[i].manhattan;
+            return;
+        }
+        int conflicts[BATCH];
+        for (size_t i = 0; i < n; i += BATCH) {
+            const size_t count = std::min(n - i, (size_t)BATCH);
+            linear_conflicts(pos + i, count, conflicts, std::integral_constant<bool, N == 4 && M == 4>());
+            for (size_t j = 0; j < count; j++) {
+                const position& p = pos[i + j];
+                const int est = p.manhattan + conflicts[j];
+                res[i + j] = (_heuristic == heuristic::linear_conflict || !_pdb) ? 
+                    (float)est : (float)std::max(est, _pdb->estimate(p.cells));
             }
         }
-        return (float)res;
     }
 
     inline bool is_target(const position& pos) const {
@@ -74,17 +150,239 @@ public:
         return pos.cells[ncells - 1] == 0;
     }
 
+    //  the target position is always fully specified
+    bool get_target(position& res) const {
+        res = position();
+        return true;
+    }
+
+    //  estimated cost between the two positions, for searching backwards: Manhattan distance,
+    //  with the linear conflicts unless in the Manhattan mode (the pattern databases only 
+    //  work for the target)
+    float estimate_cost_to(const position& pos, const position& dst) const {
+        int8_t dst_cell[N*M];
+        for (int i = 0; i < N*M; i++) dst_cell[dst.cells[i]] = (int8_t)i;
+        int res = 0;
+        for (int i = 0; i < N*M; i++) {
+            if (pos.cells[i] == 0) continue;
+            const int j = dst_cell[pos.cells[i]];
+            res += abs(i%N - j%N) + abs(i/N - j/N);
+        }
+        if (_heuristic != heuristic::manhattan) {
+            res += linear_conflict(pos.cells, [&](int tile) { return (int)dst_cell[tile]; });
+        }
+        return (float)res;
+    }
 
     inline void apply_move(const position& pos, const move& m, position& new_pos) const {
-        new_pos.cells = pos.cells;
-        new_pos.blank_pos = pos.blank_pos + m;
-        std::swap(new_pos.cells[new_pos.blank_pos], new_pos.cells[pos.blank_pos]);
+        move_blank(pos, pos.blank_pos + m, new_pos);
     }
 
     inline void unapply_move(const position& pos, const move& m, position& new_pos) const {
+        move_blank(pos, pos.blank_pos - m, new_pos);
+    }
+
+    //  the positions of up to 16 cells packed into 4 bits per cell (for the search nodes)
+    bool pack_position(const position& pos, uint64_t& res) const {
+        if (N*M > 16) return false;
+        res = 0;
+        for (int i = 0; i < N*M && i < 16; i++) res |= (uint64_t)pos.cells[i] << 4*i;
+        return true;
+    }
+
+    void unpack_position(uint64_t packed, position& res) const {
+        int8_t cells[N*M];
+        for (int i = 0; i < N*M && i < 16; i++) cells[i] = (int8_t)((packed >> 4*i) & 15);
+        res = position(cells);
+    }
+
+private:
+    static constexpr size_t BATCH = 64;     //  positions per linear_conflicts() call
+
+    heuristic                           _heuristic;
+    std::shared_ptr<const pattern_db>   _pdb;
+
+    static void linear_conflicts(const position* pos, size_t n, int* res, std::false_type) {
+        for (size_t i = 0; i < n; i++) res[i] = linear_conflict(pos[i].cells);
+    }
+
+    //  the 4x4 boards: a line (row or column) is keyed by the places in it its tiles have, 
+    //  in base 5 (4 for the tiles of the other lines and the blank), the extra moves 
+    //  of every key are looked up in conflict_table()
+    static void linear_conflicts(const position* pos, size_t n, int* res, std::true_type) {
+#ifdef SP_X86
+        const simd_level level = cpu_features::level();
+        if (level == simd_level::avx2) {
+            linear_conflicts_avx2(pos, n, res);
+            return;
+        }
+        if (level == simd_level::ssse3) {
+            linear_conflicts_ssse3(pos, n, res);
+            return;
+        }
+#endif
+        linear_conflicts(pos, n, res, std::false_type());
+    }
+
+    //  extra moves of the 4x4 board lines by their keys
+    static const uint8_t* conflict_table() {
+        static const std::vector<uint8_t> table = [] {
+            std::vector<uint8_t> res(625);
+            for (int key = 0; key < 625; key++) {
+                int line[4], n = 0;
+                for (int k = key, i = 0; i < 4; i++, k /= 5) {
+                    if (k%5 != 4) line[n++] = k%5;
+                }
+                res[key] = (uint8_t)(n - longest_increasing(line, n));
+            }
+            return res;
+        }();
+        return &table[0];
+    }
+
+#ifdef SP_X86
+    //  the keys of the 4 rows and then the 4 columns of the board (16 cells in a register),
+    //  as 16-bit integers
+    SP_TARGET_SSSE3
+    static inline __m128i line_keys(__m128i cells) {
+        //  target row and column of the tiles, none for the blank
+        const __m128i trow = _mm_setr_epi8(0x7F, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3);
+        const __m128i tcol = _mm_setr_epi8(0x7F, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2);
+        const __m128i line = _mm_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3);
+        const __m128i transpose = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+        const __m128i none = _mm_set1_epi8(4);
+        const __m128i w5 = _mm_setr_epi8(1, 5, 1, 5, 1, 5, 1, 5, 1, 5, 1, 5, 1, 5, 1, 5);
+        const __m128i w25 = _mm_setr_epi16(1, 25, 1, 25, 1, 25, 1, 25);
+
+        const __m128i rows = _mm_shuffle_epi8(trow, cells);
+        const __m128i cols = _mm_shuffle_epi8(tcol, cells);
+        __m128i in_line = _mm_cmpeq_epi8(rows, line);
+        const __m128i row_places = _mm_or_si128(_mm_and_si128(in_line, cols), _mm_andnot_si128(in_line, none));
+        const __m128i cells_t = _mm_shuffle_epi8(cells, transpose);
+        const __m128i rows_t = _mm_shuffle_epi8(trow, cells_t);
+        const __m128i cols_t = _mm_shuffle_epi8(tcol, cells_t);
+        in_line = _mm_cmpeq_epi8(cols_t, line);
+        const __m128i col_places = _mm_or_si128(_mm_and_si128(in_line, rows_t), _mm_andnot_si128(in_line, none));
+        const __m128i row_keys = _mm_madd_epi16(_mm_maddubs_epi16(row_places, w5), w25);
+        const __m128i col_keys = _mm_madd_epi16(_mm_maddubs_epi16(col_places, w5), w25);
+        return _mm_packs_epi32(row_keys, col_keys);
+    }
+
+    SP_TARGET_SSSE3
+    static void linear_conflicts_ssse3(const position* pos, size_t n, int* res) {
+        const uint8_t* table = conflict_table();
+        alignas(16) uint16_t keys[8];
+        for (size_t i = 0; i < n; i++) {
+            _mm_store_si128((__m128i*)keys, line_keys(_mm_loadu_si128((const __m128i*)&pos[i].cells[0])));
+            res[i] = 2*(table[keys[0]] + table[keys[1]] + table[keys[2]] + table[keys[3]] + 
+                table[keys[4]] + table[keys[5]] + table[keys[6]] + table[keys[7]]);
+        }
+    }
+
+    //  two boards at a time, one in each 128-bit lane
+    SP_TARGET_AVX2
+    static void linear_conflicts_avx2(const position* pos, size_t n, int* res) {
+        const __m256i trow = _mm256_setr_epi8(0x7F, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3,
+            0x7F, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3);
+        const __m256i tcol = _mm256_setr_epi8(0x7F, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2,
+            0x7F, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2);
+        const __m256i line = _mm256_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+            0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3);
+        const __m256i transpose = _mm256_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+            0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+        const __m256i none = _mm256_set1_epi8(4);
+        const __m256i w5 = _mm256_set1_epi16(5 << 8 | 1);
+        const __m256i w25 = _mm256_set1_epi32(25 << 16 | 1);
+
+        const uint8_t* table = conflict_table();
+        alignas(32) uint16_t keys[16];
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            const __m256i cells = _mm256_inserti128_si256(_mm256_castsi128_si256(
+                _mm_loadu_si128((const __m128i*)&pos[i].cells[0])), 
+                _mm_loadu_si128((const __m128i*)&pos[i + 1].cells[0]), 1);
+            const __m256i rows = _mm256_shuffle_epi8(trow, cells);
+            const __m256i cols = _mm256_shuffle_epi8(tcol, cells);
+            __m256i in_line = _mm256_cmpeq_epi8(rows, line);
+            const __m256i row_places = _mm256_blendv_epi8(none, cols, in_line);
+            const __m256i cells_t = _mm256_shuffle_epi8(cells, transpose);
+            const __m256i rows_t = _mm256_shuffle_epi8(trow, cells_t);
+            const __m256i cols_t = _mm256_shuffle_epi8(tcol, cells_t);
+            in_line = _mm256_cmpeq_epi8(cols_t, line);
+            const __m256i col_places = _mm256_blendv_epi8(none, rows_t, in_line);
+            const __m256i row_keys = _mm256_madd_epi16(_mm256_maddubs_epi16(row_places, w5), w25);
+            const __m256i col_keys = _mm256_madd_epi16(_mm256_maddubs_epi16(col_places, w5), w25);
+            //  packs within the lanes: the 8 keys of a board in each
+            _mm256_store_si256((__m256i*)keys, _mm256_packs_epi32(row_keys, col_keys));
+            for (int b = 0; b < 2; b++) {
+                const uint16_t* k = keys + 8*b;
+                res[i + b] = 2*(table[k[0]] + table[k[1]] + table[k[2]] + table[k[3]] + 
+                    table[k[4]] + table[k[5]] + table[k[6]] + table[k[7]]);
+            }
+        }
+        if (i < n) linear_conflicts_ssse3(pos + i, n - i, res + i);
+    }
+#endif
+
+    //  extra moves for the linear conflicts: in every row (column), the tiles 
+    //  of the row (column) not in the longest increasing subsequence of their target 
+    //  columns (rows) have to leave it and come back.
+    //  target_cell(tile) is the tile's target cell
+    template <typename TTarget>
+    static int linear_conflict(const cell_arr& cells, TTarget target_cell) {
+        int res = 0;
+        int line[N > M ? N : M];
+        for (int y = 0; y < M; y++) {
+            int n = 0;
+            for (int x = 0; x < N; x++) {
+                const int tile = cells[x + y*N];
+                if (tile == 0) continue;
+                const int t = target_cell(tile);
+                if (t/N == y) line[n++] = t%N;
+            }
+            res += n - longest_increasing(line, n);
+        }
+        for (int x = 0; x < N; x++) {
+            int n = 0;
+            for (int y = 0; y < M; y++) {
+                const int tile = cells[x + y*N];
+                if (tile == 0) continue;
+                const int t = target_cell(tile);
+                if (t%N == x) line[n++] = t/N;
+            }
+            res += n - longest_increasing(line, n);
+        }
+        return 2*res;
+    }
+
+    static int linear_conflict(const cell_arr& cells) {
+        return linear_conflict(cells, [](int tile) { return tile - 1; });
+    }
+
+    static int longest_increasing(const int* v, int n) {
+        int len[N > M ? N : M];
+        int res = 0;
+        for (int i = 0; i < n; i++) {
+            len[i] = 1;
+            for (int j = 0; j < i; j++) {
+                if (v[j] < v[i]) len[i] = std::max(len[i], len[j] + 1);
+            }
+            res = std::max(res, len[i]);
+        }
+        return res;
+    }
+
+    //  the tile at blank_pos moves into the old blank cell
+    inline void move_blank(const position& pos, int blank_pos, position& new_pos) const {
+        const uint64_t* keys = zobrist_keys();
+        const int old_blank = pos.blank_pos;
+        const int tile = pos.cells[blank_pos];
         new_pos.cells = pos.cells;
-        new_pos.blank_pos = pos.blank_pos - m;
-        std::swap(new_pos.cells[new_pos.blank_pos], new_pos.cells[pos.blank_pos]);
+        new_pos.blank_pos = blank_pos;
+        std::swap(new_pos.cells[blank_pos], new_pos.cells[old_blank]);
+        new_pos.zobrist = pos.zobrist ^ keys[blank_pos*N*M + tile] ^ keys[old_blank*N*M + tile];
+        const uint8_t* dist = manhattan_table() + tile*N*M;
+        new_pos.manhattan = pos.manhattan - dist[blank_pos] + dist[old_blank];
     }
 };
 
@@ -0,0 +1,263 @@
+#ifndef __NPUZZLE_PDB__
+#define __NPUZZLE_PDB__
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <bitset>
+#include <algorithm>
+
+#include "mapped_file.hpp"
+
+//  Additive disjoint pattern databases for npuzzle (N columns, M rows).
+//
+//  The tiles are partitioned into disjoint patterns. For every pattern the table keeps
+//  the number of moves of the pattern tiles needed to get them home, the moves of the other
+//  tiles being free, so the sum over the patterns is an admissible heuristic.
+//  A pattern position is the cells of the pattern tiles, ranked as a partial permutation
+//  (CELLS!/(CELLS - k)! entries for k tiles), one byte per entry.
+//
+//  The tables are computed by 0-1 breadth first search over the pattern positions
+//  with the blank (which is where the free moves go), the minimum over the blank cells
+//  is stored. Memory needed is one byte per the pattern position with the blank,
+//  e.g. 58M for a 6-tile pattern of the 15-puzzle, 4G for an 8-tile one.
+template <int N, int M = N>
+class npuzzle_pdb {
+public:
+    static constexpr int CELLS = N*M;
+
+    npuzzle_pdb() : _data(nullptr) {}
+
+    npuzzle_pdb(const npuzzle_pdb&) = delete;
+    npuzzle_pdb& operator =(const npuzzle_pdb&) = delete;
+
+    //  computes the tables for the given partition of the tiles (1..CELLS-1),
+    //  false if the partition is not valid
+    bool generate(const std::vector<std::vector<int>>& partition) {
+        if (!set_partition(partition)) return false;
+        _file.close();
+        _mem.assign(_offsets.back(), 0xFF);
+        _data = &_mem[0];
+        for (size_t i = 0; i < _patterns.size(); i++) {
+            generate_pattern(_patterns[i], &_mem[_offsets[i]]);
+        }
+        return true;
+    }
+
+    bool save(const std::string& path) const {
+        FILE* f = fopen(path.c_str(), "wb");
+        if (!f) return false;
+        const header h = make_header();
+        bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+            fwrite(_data, 1, _offsets.back(), f) == _offsets.back();
+        ok = (fclose(f) == 0) && ok;
+        return ok;
+    }
+
+    //  memory-maps the tables, the partition is read from the file
+    bool load(const std::string& path) {
+        _mem.clear();
+        _data = nullptr;
+        if (!_file.open(path)) return false;
+        header h;
+        bool ok = _file.size() >= sizeof(h);
+        if (ok) {
+            memcpy(&h, _file.data(), sizeof(h));
+            ok = memcmp(h.magic, "NPDB", 4) == 0 && h.version == VERSION &&
+                h.cols == N && h.rows == M;
+        }
+        if (ok) {
+            std::vector<std::vector<int>> partition;
+            for (int t = 1; t < CELLS; t++) {
+                const int p = h.tile_pattern[t];
+                if (p == NONE) continue;
+                if (p >= (int)partition.size()) partition.resize(p + 1);
+                partition[p].push_back(t);
+            }
+            ok = set_partition(partition) && _file.size() == sizeof(h) + _offsets.back();
+        }
+        if (!ok) {
+            _file.close();
+            return false;
+        }
+        _data = _file.data() + sizeof(h);
+        return true;
+    }
+
+    bool empty() const { return _data == nullptr; }
+    uint64_t bytes() const { return _offsets.empty() ? 0 : _offsets.back(); }
+    const std::vector<std::vector<int>>& partition() const { return _patterns; }
+
+    //  sum of the pattern distances, cells are the tiles (0 for the blank) by cell
+    template <typename TCells>
+    inline int estimate(const TCells& cells) const {
+        int8_t tile_cell[CELLS];
+        for (int i = 0; i < CELLS; i++) tile_cell[cells[i]] = (int8_t)i;
+        int res = 0;
+        int8_t p[CELLS];
+        const int npatterns = (int)_patterns.size();
+        for (int i = 0; i < npatterns; i++) {
+            const auto& tiles = _patterns[i];
+            const int k = (int)tiles.size();
+            for (int j = 0; j < k; j++) p[j] = tile_cell[tiles[j]];
+            res += _data[_offsets[i] + rank(p, k)];
+        }
+        return res;
+    }
+
+    //  number of the partial permutations of k cells
+    static uint64_t num_entries(int k) {
+        uint64_t res = 1;
+        for (int i = 0; i < k; i++) res *= CELLS - i;
+        return res;
+    }
+
+    //  ranks the k distinct cells as a partial permutation 
+    //  (the ranks fit 32 bits for all the valid partitions, see set_partition())
+    static inline uint32_t rank(const int8_t* p, int k) {
+        uint32_t res = 0;
+        uint64_t used = 0;
+        for (int i = 0; i < k; i++) {
+            const uint64_t bit = 1ull << p[i];
+            const int idx = p[i] - (int)std::bitset<64>(used & (bit - 1)).count();
+            res = res*(CELLS - i) + idx;
+            used |= bit;
+        }
+        return res;
+    }
+
+    static inline void unrank(uint32_t r, int8_t* p, int k) {
+        int idx[CELLS];
+        for (int i = k - 1; i >= 0; i--) {
+            idx[i] = (int)(r%(CELLS - i));
+            r /= CELLS - i;
+        }
+        uint64_t used = 0;
+        for (int i = 0; i < k; i++) {
+            int c = 0;
+            for (int n = idx[i]; ; c++) {
+                if (used & (1ull << c)) continue;
+                if (n-- == 0) break;
+            }
+            p[i] = (int8_t)c;
+            used |= 1ull << c;
+        }
+    }
+
+private:
+    static_assert(CELLS <= 64, "Board is too large for the pattern databases");
+
+    static constexpr uint8_t NONE = 0xFF;
+    static constexpr uint32_t VERSION = 1;
+
+    struct header {
+        char        magic[4];
+        uint32_t    version;
+        uint32_t    cols;
+        uint32_t    rows;
+        uint8_t     tile_pattern[(CELLS + 7)/8*8];  //  pattern of every tile, NONE if not used
+    };
+
+    std::vector<std::vector<int>>   _patterns;  //  tiles of every pattern, ascending
+    std::vector<uint64_t>           _offsets;   //  table offset of every pattern, then total size
+    std::vector<uint8_t>            _mem;       //  generated tables
+    const uint8_t*                  _data;      //  either generated or memory-mapped tables
+    mapped_file                     _file;      //  memory-mapped tables file
+
+    bool set_partition(std::vector<std::vector<int>> partition) {
+        std::vector<bool> used(CELLS, false);
+        _offsets.assign(1, 0);
+        for (auto& tiles : partition) {
+            std::sort(tiles.begin(), tiles.end());
+            //  the 8-tile pattern of the 15-puzzle is the largest with 32-bit ranks
+            if (tiles.empty() || num_entries((int)tiles.size() + 1) > UINT32_MAX) return false;
+            for (auto t : tiles) {
+                if (t <= 0 || t >= CELLS || used[t]) return false;
+                used[t] = true;
+            }
+            _offsets.push_back(_offsets.back() + num_entries((int)tiles.size()));
+        }
+        _patterns = partition;
+        return true;
+    }
+
+    header make_header() const {
+        header h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, "NPDB", 4);
+        h.version = VERSION;
+        h.cols = N;
+        h.rows = M;
+        memset(h.tile_pattern, NONE, sizeof(h.tile_pattern));
+        for (size_t i = 0; i < _patterns.size(); i++) {
+            for (auto t : _patterns[i]) h.tile_pattern[t] = (uint8_t)i;
+        }
+        return h;
+    }
+
+    //  0-1 breadth first search from the target over the pattern positions with the blank
+    //  (the blank is the last one of the ranked cells)
+    static void generate_pattern(const std::vector<int>& tiles, uint8_t* table) {
+        const int k = (int)tiles.size();
+        std::vector<uint8_t> dist(num_entries(k + 1), (uint8_t)NONE);
+        std::vector<uint32_t> layer, next;
+
+        int8_t p[CELLS + 1];
+        for (int j = 0; j < k; j++) p[j] = (int8_t)(tiles[j] - 1);
+        p[k] = CELLS - 1;
+        const uint32_t target = rank(p, k + 1);
+        dist[target] = 0;
+        layer.push_back(target);
+
+        int8_t occupied[CELLS];
+        for (uint8_t d = 0; !layer.empty(); d++) {
+            next.clear();
+            //  the layer grows with the positions reached by the free moves
+            for (size_t i = 0; i < layer.size(); i++) {
+                const uint32_t r = layer[i];
+                if (dist[r] != d) continue;
+                unrank(r, p, k + 1);
+                std::fill(occupied, occupied + CELLS, -1);
+                for (int j = 0; j < k; j++) occupied[p[j]] = (int8_t)j;
+
+                const int blank = p[k];
+                const int bx = blank%N;
+                const int by = blank/N;
+                const int cells[] = {
+                    bx > 0 ? blank - 1 : -1, bx < N - 1 ? blank + 1 : -1,
+                    by > 0 ? blank - N : -1, by < M - 1 ? blank + N : -1 };
+                for (int c : cells) {
+                    if (c < 0) continue;
+                    const int j = occupied[c];
+                    if (j >= 0) p[j] = (int8_t)blank;
+                    p[k] = (int8_t)c;
+                    const uint32_t r1 = rank(p, k + 1);
+                    if (j >= 0) {
+                        p[j] = (int8_t)c;
+                        if (dist[r1] == NONE) {
+                            dist[r1] = d + 1;
+                            next.push_back(r1);
+                        }
+                    } else if (dist[r1] > d) {
+                        dist[r1] = d;
+                        layer.push_back(r1);
+                    }
+                    p[k] = (int8_t)blank;
+                }
+            }
+            layer.swap(next);
+        }
+
+        //  the minimum over the blank cells
+        const uint64_t size = dist.size();
+        const int nblank = CELLS - k;
+        for (uint64_t r = 0; r < size; r++) {
+            uint8_t& v = table[r/nblank];
+            v = std::min(v, dist[r]);
+        }
+    }
+};
+
+#endif // __NPUZZLE_PDB__
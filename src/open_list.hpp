@@ -0,0 +1,178 @@
+#ifndef __OPEN_LIST__
+#define __OPEN_LIST__
+
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+//  Open list (front queue) policies for astar.
+//
+//  A policy is instantiated with the search node type and the node access type. The latter
+//  defines the entries the queue keeps (ref, with null() for none) and reads the costs of
+//  the nodes they refer to; by default the entries are the node pointers, and the node is
+//  expected to provide cost_from_src, total_cost() and in_front. The interface is:
+//      push(n)     - add node to the queue
+//      erase(n)    - remove node before its cost gets changed (decrease-key is erase+push)
+//      top()       - the best node without extracting it, null() if the queue is exhausted
+//      pop()       - extract the best node, null() if the queue is exhausted
+//      empty()     - whether there is nothing left to pop (may be conservative)
+//      size()      - number of entries stored (including stale ones for lazy queues)
+
+template <typename TNode>
+struct node_ptr_access {
+    typedef TNode* ref;
+
+    static ref null() { return nullptr; }
+    float total_cost(const TNode* n) const { return n->total_cost(); }
+    float cost_from_src(const TNode* n) const { return n->cost_from_src; }
+    bool in_front(const TNode* n) const { return n->in_front; }
+};
+
+//  ordered set based queue, exact float ordering, ties broken by node address (or index)
+template <typename TNode, typename TAccess = node_ptr_access<TNode>>
+class set_queue {
+public:
+    typedef typename TAccess::ref ref;
+
+    explicit set_queue(const TAccess& access = TAccess()) : _set(less(access)) {}
+
+    void push(ref n) { _set.insert(n); }
+    void erase(ref n) { _set.erase(n); }
+
+    ref top() const { return _set.empty() ? TAccess::null() : *_set.begin(); }
+
+    ref pop() {
+        if (_set.empty()) return TAccess::null();
+        ref n = *_set.begin();
+        _set.erase(_set.begin());
+        return n;
+    }
+
+    bool empty() const { return _set.empty(); }
+    size_t size() const { return _set.size(); }
+
+private:
+    struct less {
+        TAccess access;
+
+        explicit less(const TAccess& a) : access(a) {}
+
+        bool operator() (ref nl, ref nr) const {
+            const float costl = access.total_cost(nl);
+            const float costr = access.total_cost(nr);
+            return (costl == costr) ? (nl < nr) : (costl < costr);
+        }
+    };
+
+    std::set<ref, less> _set;
+};
+
+//  two-level bucketed queue: the first level is indexed by the quantized total cost (f),
+//  the second one by the quantized cost from source (g), used for tie-breaking.
+//  Costs are multiplied by Scale and rounded, so Scale=2 keeps half-integer costs exact.
+//  Decrease-key is done via lazy deletion: erase() is a no-op and stale entries
+//  (the ones whose node cost has changed or which have left the front) are skipped on pop.
+template <typename TNode, int Scale = 2, bool PreferHighG = true, typename TAccess = node_ptr_access<TNode>>
+class bucket_queue {
+public:
+    typedef typename TAccess::ref ref;
+
+    explicit bucket_queue(const TAccess& access = TAccess()) : _access(access), _min_f(0), _size(0) {}
+
+    void push(ref n) {
+        const uint32_t fk = f_key(n);
+        const uint32_t gk = g_key(n);
+        if (fk >= _levels.size()) _levels.resize(fk + 1);
+        level& lv = _levels[fk];
+        if (gk >= lv.buckets.size()) lv.buckets.resize(gk + 1);
+        lv.buckets[gk].push_back(n);
+        if (lv.count++ == 0) {
+            lv.best_g = gk;
+        } else {
+            lv.best_g = better_g(lv.best_g, gk);
+        }
+        if (fk < _min_f || _size == 0) _min_f = fk;
+        _size++;
+    }
+
+    void erase(ref) {}
+
+    //  drops the stale entries on the way
+    ref top() {
+        while (_size > 0) {
+            while (_levels[_min_f].count == 0) _min_f++;
+            level& lv = _levels[_min_f];
+            //  find the best non-empty bucket in the level
+            while (lv.buckets[lv.best_g].empty()) {
+                lv.best_g += PreferHighG ? -1 : 1;
+            }
+            auto& bucket = lv.buckets[lv.best_g];
+            ref n = bucket.back();
+            if (_access.in_front(n) && f_key(n) == _min_f && g_key(n) == lv.best_g) {
+                return n;
+            }
+            //  a stale entry, skip it
+            bucket.pop_back();
+            lv.count--;
+            _size--;
+        }
+        return TAccess::null();
+    }
+
+    ref pop() {
+        ref n = top();
+        if (n != TAccess::null()) {
+            //  top() left the node at the back of the best bucket
+            level& lv = _levels[_min_f];
+            lv.buckets[lv.best_g].pop_back();
+            lv.count--;
+            _size--;
+        }
+        return n;
+    }
+
+    bool empty() const { return _size == 0; }
+    size_t size() const { return _size; }
+
+private:
+    struct level {
+        std::vector<std::vector<ref>>       buckets;    //  nodes, indexed by g key
+        uint32_t                            best_g;     //  best (non-empty) g key
+        uint32_t                            count;      //  number of nodes in the level
+
+        level() : best_g(0), count(0) {}
+    };
+
+    TAccess             _access;    //  node costs of the entries
+    std::vector<level>  _levels;    //  levels, indexed by f key
+    uint32_t            _min_f;     //  lowest (potentially) non-empty level
+    size_t              _size;      //  total number of entries, including stale ones
+
+    inline uint32_t f_key(ref n) const {
+        return (uint32_t)std::lround(_access.total_cost(n)*Scale);
+    }
+
+    inline uint32_t g_key(ref n) const {
+        return (uint32_t)std::lround(_access.cost_from_src(n)*Scale);
+    }
+
+    static inline uint32_t better_g(uint32_t a, uint32_t b) {
+        return PreferHighG ? std::max(a, b) : std::min(a, b);
+    }
+};
+
+//  queue policies to be passed to astar
+struct set_queue_policy {
+    template <typename TNode, typename TAccess = node_ptr_access<TNode>>
+    using queue = set_queue<TNode, TAccess>;
+};
+
+template <int Scale = 2, bool PreferHighG = true>
+struct bucket_queue_policy {
+    template <typename TNode, typename TAccess = node_ptr_access<TNode>>
+    using queue = bucket_queue<TNode, Scale, PreferHighG, TAccess>;
+};
+
+#endif // __OPEN_LIST__
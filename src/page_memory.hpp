@@ -0,0 +1,127 @@
+#ifndef __PAGE_MEMORY__
+#define __PAGE_MEMORY__
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+//  how the large blocks (of a huge page or more) get backed by the huge pages:
+//      none        - regular pages only
+//      advise      - transparent huge pages (madvise(MADV_HUGEPAGE)) where supported
+//      reserved    - the reserved huge pages (MAP_HUGETLB), or the large pages on Windows
+//                    (which need the "lock pages in memory" privilege), falling back to advise
+enum class huge_pages { none, advise, reserved };
+
+//  Memory blocks straight from the OS pages, for the arenas of the search nodes
+//  (pool_alloc, node_arena). The pages are only committed as they get touched,
+//  so a block can be larger than it ends up being used. The block sizes are rounded up
+//  to the pages actually mapped, allocate() returns the rounded size for free().
+//  The huge page mode is process-wide, it only affects the blocks allocated after it is set
+class page_memory {
+public:
+    static constexpr size_t HUGE_PAGE_SIZE = (size_t)2 << 20;
+
+    static void set_huge_pages(huge_pages mode) { mode_ref().store((int)mode); }
+    static huge_pages get_huge_pages() { return (huge_pages)mode_ref().load(); }
+
+    //  a zeroed block of at least the given size (updated to the size mapped), null if out of memory
+    static void* allocate(size_t& bytes) {
+        const huge_pages mode = get_huge_pages();
+        const bool huge = mode != huge_pages::none && bytes >= HUGE_PAGE_SIZE;
+#ifdef _WIN32
+        if (huge && mode == huge_pages::reserved) {
+            const size_t large = GetLargePageMinimum();
+            if (large > 0) {
+                const size_t size = round_up(bytes, large);
+                void* res = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+                if (res != NULL) {
+                    bytes = size;
+                    return res;
+                }
+            }
+        }
+        const size_t size = round_up(bytes, page_size());
+        void* res = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if (res == NULL) return nullptr;
+        bytes = size;
+        return res;
+#else
+#ifdef MAP_HUGETLB
+        if (huge && mode == huge_pages::reserved) {
+            const size_t size = round_up(bytes, HUGE_PAGE_SIZE);
+            void* res = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (res != MAP_FAILED) {
+                bytes = size;
+                return res;
+            }
+        }
+#endif
+        if (!huge) {
+            const size_t size = round_up(bytes, page_size());
+            void* res = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (res == MAP_FAILED) return nullptr;
+            bytes = size;
+            return res;
+        }
+        //  the transparent huge pages need the huge page alignment:
+        //  mapped with a huge page to spare, the unaligned ends unmapped
+        const size_t size = round_up(bytes, HUGE_PAGE_SIZE);
+        char* map = (char*)mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == (char*)MAP_FAILED) return nullptr;
+        char* res = (char*)round_up((size_t)map, HUGE_PAGE_SIZE);
+        if (res > map) munmap(map, res - map);
+        if (map + HUGE_PAGE_SIZE > res) munmap(res + size, map + HUGE_PAGE_SIZE - res);
+#ifdef MADV_HUGEPAGE
+        madvise(res, size, MADV_HUGEPAGE);
+#endif
+        bytes = size;
+        return res;
+#endif
+    }
+
+    //  bytes is the size allocate() returned
+    static void free(void* mem, size_t bytes) {
+        if (!mem) return;
+#ifdef _WIN32
+        VirtualFree(mem, 0, MEM_RELEASE);
+#else
+        munmap(mem, bytes);
+#endif
+    }
+
+    static size_t page_size() {
+        static const size_t size = [] {
+#ifdef _WIN32
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            return (size_t)info.dwPageSize;
+#else
+            return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+        }();
+        return size;
+    }
+
+private:
+    static std::atomic<int>& mode_ref() {
+        static std::atomic<int> mode((int)huge_pages::advise);
+        return mode;
+    }
+
+    static inline size_t round_up(size_t bytes, size_t align) {
+        return (bytes + align - 1)/align*align;
+    }
+};
+
+#endif // __PAGE_MEMORY__
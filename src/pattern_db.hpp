@@ -0,0 +1,158 @@
+#ifndef __PATTERN_DB__
+#define __PATTERN_DB__
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mapped_file.hpp"
+
+//  Pattern database: exact distances to the target in an abstracted puzzle,
+//  which keeps only a subset of the pieces (the pattern).
+//
+//  An abstract position is ranked as a mixed radix number, with a digit per pattern piece,
+//  which is the index of the piece offset among all the offsets the piece fits the board at.
+//  The distances are stored as 4 bits per entry (capped at MAX_DIST), either in memory or
+//  memory-mapped from a cache file. The file is keyed by a hash of everything the distances
+//  depend on (board size, pattern pieces' shapes and targets).
+class pattern_db {
+public:
+    static constexpr uint8_t MAX_DIST = 15;
+
+    struct piece_desc {
+        uint8_t     id;         //  piece id in the original puzzle
+        int8_t      width;      //  bounding box width
+        int8_t      height;     //  bounding box height
+    };
+
+    pattern_db(uint64_t key, int rows, int cols, const std::vector<piece_desc>& pieces) :
+        _key(key), _pieces(pieces), _data(nullptr) {
+        _num_entries = 1;
+        for (const auto& p : _pieces) {
+            _radix.push_back(cols - p.width + 1);
+            _num_offsets.push_back((cols - p.width + 1)*(rows - p.height + 1));
+            _num_entries *= _num_offsets.back();
+        }
+    }
+
+    pattern_db(const pattern_db&) = delete;
+    pattern_db& operator =(const pattern_db&) = delete;
+
+    uint64_t key() const { return _key; }
+    uint64_t size() const { return _num_entries; }
+    const std::vector<piece_desc>& pieces() const { return _pieces; }
+    bool is_mapped() const { return _file.is_open(); }
+
+    //  offs(k) provides the offset of the k-th pattern piece
+    template <typename TOffs>
+    inline uint64_t rank(const TOffs& offs) const {
+        uint64_t res = 0;
+        const int npieces = (int)_pieces.size();
+        for (int k = npieces - 1; k >= 0; k--) {
+            const auto o = offs(k);
+            res = res*_num_offsets[k] + o.dx + o.dy*_radix[k];
+        }
+        return res;
+    }
+
+    //  set(k, dx, dy) receives the offset of the k-th pattern piece
+    template <typename TSet>
+    inline void unrank(uint64_t r, const TSet& set) const {
+        const int npieces = (int)_pieces.size();
+        for (int k = 0; k < npieces; k++) {
+            const int idx = (int)(r%_num_offsets[k]);
+            r /= _num_offsets[k];
+            set(k, idx%_radix[k], idx/_radix[k]);
+        }
+    }
+
+    int num_offsets(int k) const { return _num_offsets[k]; }
+
+    inline uint8_t get(uint64_t r) const {
+        return (_data[r >> 1] >> ((r & 1)*4)) & 0xF;
+    }
+
+    inline void set(uint64_t r, uint8_t v) {
+        uint8_t& b = _mem[r >> 1];
+        b = (r & 1) ? ((b & 0x0F) | (v << 4)) : ((b & 0xF0) | v);
+    }
+
+    //  allocates the in-memory table, all the entries set to MAX_DIST
+    void alloc() {
+        _file.close();
+        _mem.assign((size_t)((_num_entries + 1)/2), 0xFF);
+        _data = &_mem[0];
+    }
+
+    template <typename TPos>
+    inline float lookup(const TPos& pos) const {
+        return (float)get(rank([&](int k) { return pos.offsets[_pieces[k].id]; }));
+    }
+
+    static std::string file_name(const std::string& dir, uint64_t key) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%016llx.pdb", (unsigned long long)key);
+        return dir.empty() ? std::string(buf) : dir + "/" + buf;
+    }
+
+    bool save(const std::string& path) const {
+        FILE* f = fopen(path.c_str(), "wb");
+        if (!f) return false;
+        const header h = make_header();
+        bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+            fwrite(_data, 1, data_bytes(), f) == data_bytes();
+        ok = (fclose(f) == 0) && ok;
+        return ok;
+    }
+
+    //  memory-maps the table from the file, fails if the file does not match the pattern
+    bool load(const std::string& path) {
+        _data = _mem.empty() ? nullptr : &_mem[0];
+        if (!_file.open(path)) return false;
+        const header h = make_header();
+        if (_file.size() != sizeof(header) + data_bytes() || 
+            memcmp(_file.data(), &h, sizeof(h)) != 0) {
+            _file.close();
+            return false;
+        }
+        _data = _file.data() + sizeof(header);
+        return true;
+    }
+
+private:
+    struct header {
+        char        magic[4];
+        uint32_t    version;
+        uint64_t    key;
+        uint64_t    num_entries;
+        uint64_t    reserved;
+    };
+
+    static constexpr uint32_t VERSION = 1;
+
+    uint64_t                _key;           //  pattern key (puzzle hash)
+    std::vector<piece_desc> _pieces;        //  pattern pieces
+    std::vector<int>        _radix;         //  number of possible x offsets for every piece
+    std::vector<int>        _num_offsets;   //  number of possible offsets for every piece
+    uint64_t                _num_entries;   //  total number of abstract positions
+
+    std::vector<uint8_t>    _mem;           //  in-memory table (two entries per byte)
+    const uint8_t*          _data;          //  either in-memory or memory-mapped table
+    mapped_file             _file;          //  memory-mapped cache file
+
+    size_t data_bytes() const { return (size_t)((_num_entries + 1)/2); }
+
+    header make_header() const {
+        header h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, "SPDB", 4);
+        h.version = VERSION;
+        h.key = _key;
+        h.num_entries = _num_entries;
+        return h;
+    }
+};
+
+#endif // __PATTERN_DB__
@@ -2,74 +2,116 @@
 #define __POOL_ALLOC__
 
 #include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+#include "page_memory.hpp"
 
 namespace test { class test_pool_alloc; };
 
+//  element allocator for the nodes which get freed individually.
+//  The pages come from page memory (see page_memory.hpp), each next one grow_rate times
+//  larger; the elements are handed out from the current page by bumping a pointer,
+//  and the free list only threads the freed ones, so the memory only gets touched
+//  as it is used. reset() drops all the elements at once, keeping the pages.
+//  An allocator is not thread-safe, the parallel searches keep one per thread
 template <typename TElem>
 class pool_alloc {
 public:
-    pool_alloc(size_t start_page_size = 256, float grow_rate = 1.0) :
-        _grow_rate(grow_rate) {
-        _pages.push_back({ start_page_size });
-        init_page(_pages.back());
-        _head = _pages.back().mem;
-    }
+    pool_alloc(size_t start_page_size = 256, float grow_rate = 2.0f) :
+        _start_page_size(start_page_size > 0 ? start_page_size : 1), _grow_rate(grow_rate),
+        _page(0), _next(nullptr), _end(nullptr), _free(nullptr), _size(0), _capacity(0), _bytes(0) {}
 
     ~pool_alloc() {
-        for (auto p : _pages) {
-            ::free(p.mem);
+        for (const auto& p : _pages) {
+            page_memory::free(p.mem, p.bytes);
         }
     }
 
+    pool_alloc(const pool_alloc&) = delete;
+    pool_alloc& operator =(const pool_alloc&) = delete;
+
     TElem* allocate() {
-        TElem* next_free = *((TElem**)_head);
-        TElem* res = _head;
-        if (next_free == nullptr) {
-            //  no more free cells, allocate new page
-            _pages.push_back({ (size_t)(_pages.back().size*_grow_rate) });
-            init_page(_pages.back());
-            _head = _pages.back().mem;
+        TElem* res = _free;
+        if (res != nullptr) {
+            _free = *((TElem**)res);
         } else {
-            _head = next_free;
+            if (_next == _end) next_page();
+            res = _next++;
         }
         new (res) TElem();
+        _size++;
         return res;
     }
 
     void free(TElem* elem) {
         elem->~TElem();
-        *((TElem**)elem) = _head;
-        _head = elem;
+        *((TElem**)elem) = _free;
+        _free = elem;
+        _size--;
     }
 
+    //  drops all the elements in constant time (without destroying them), keeping the pages
+    void reset() {
+        _page = 0;
+        _next = _end = nullptr;
+        if (!_pages.empty()) {
+            _next = _pages[0].mem;
+            _end = _next + _pages[0].size;
+        }
+        _free = nullptr;
+        _size = 0;
+    }
+
+    //  number of the elements allocated (and not freed)
     uint64_t size() const { return _size; }
+    //  number of the elements the pages fit
+    uint64_t capacity() const { return _capacity; }
+    double occupancy() const { return _capacity ? (double)_size/_capacity : 0.0; }
+    //  memory taken by the pages, bytes
+    uint64_t bytes() const { return _bytes; }
 
 private:
     struct page
     {
-        size_t  size;    //  number of elements in the page
-        TElem*   mem;    //  pointer to the page memory
+        size_t  size;   //  number of elements in the page
+        TElem*  mem;    //  pointer to the page memory
+        size_t  bytes;  //  mapped size of the page
     };
 
     std::vector<page>   _pages;     //  pages registry
-    TElem*              _head;      //  pointer to the first free element
+    size_t              _start_page_size;
     float               _grow_rate; //  page size grow ratio
-    size_t              _size;      //  total size, bytes
-
-    void init_page(page& p) {
-        size_t page_size = p.size*sizeof(TElem);
-        _size += page_size;
-        p.mem = (TElem*)malloc(page_size);
-        *((TElem**)&p.mem[p.size - 1]) = nullptr;
-        for (int i = p.size - 2; i >= 0; i--) {
-            *((TElem**)&p.mem[i]) = &p.mem[i + 1];
+    size_t              _page;      //  current page
+    TElem*              _next;      //  next element of the current page never allocated
+    TElem*              _end;       //  end of the current page
+    TElem*              _free;      //  first freed element
+    uint64_t            _size;      //  number of elements allocated
+    uint64_t            _capacity;  //  number of elements in the pages
+    uint64_t            _bytes;     //  memory taken by the pages, bytes
+
+    //  moves to the next page, the one kept from before reset() or a new one
+    void next_page() {
+        if (_next != nullptr) _page++;
+        if (_page == _pages.size()) {
+            const size_t size = _pages.empty() ? _start_page_size :
+                std::max((size_t)(_pages.back().size*_grow_rate), (size_t)1);
+            size_t bytes = size*sizeof(TElem);
+            TElem* mem = (TElem*)page_memory::allocate(bytes);
+            if (!mem) throw std::bad_alloc();
+            _pages.push_back({ size, mem, bytes });
+            _capacity += size;
+            _bytes += bytes;
         }
+        _next = _pages[_page].mem;
+        _end = _next + _pages[_page].size;
     }
 
-    static_assert(sizeof(TElem) >= sizeof(TElem*), 
+    static_assert(sizeof(TElem) >= sizeof(TElem*),
         "Element size must be sufficient to contain a pointer type");
 
     friend class test::test_pool_alloc;
 };
 
-#endif
\ No newline at end of file
+#endif // __POOL_ALLOC__
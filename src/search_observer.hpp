@@ -0,0 +1,133 @@
+#ifndef __SEARCH_OBSERVER__
+#define __SEARCH_OBSERVER__
+
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+
+//  Observer policies for astar, notified about the search events.
+//
+//  The interface is:
+//      enabled             - compile time constant, whether astar should notify the observer
+//      timer(obs, phase)   - scope guard timing a search phase
+//      on_expand(f, g)     - a node taken from the front queue to be expanded
+//      on_generate()       - a successor generated
+//      on_duplicate()      - a successor found in the visited registry
+//      on_update(in_front) - a better path to a visited node, in the front queue or reopened
+//      on_progress(front_size, num_visited, bytes) - after every expansion
+//  The null observer does nothing and is optimized out completely.
+
+enum class search_phase {
+    moves,          //  move generation
+    heuristic,      //  cost estimation
+    hashing,        //  position hashing and visited registry lookups
+    queue,          //  front queue operations
+    count
+};
+
+struct null_observer {
+    static constexpr bool enabled = false;
+
+    struct timer {
+        timer(null_observer&, search_phase) {}
+    };
+
+    void on_expand(float, float) {}
+    void on_generate() {}
+    void on_duplicate() {}
+    void on_update(bool) {}
+    void on_progress(size_t, uint32_t, uint64_t) {}
+};
+
+struct search_stats {
+    uint64_t    expanded;       //  nodes expanded
+    uint64_t    generated;      //  successors generated
+    uint64_t    duplicates;     //  successors already visited
+    uint64_t    updated;        //  better paths to the nodes in the front queue
+    uint64_t    reopened;       //  better paths to the expanded nodes
+    float       max_f;          //  highest total cost expanded so far
+    size_t      front_size;     //  front queue entries (including the stale ones)
+    uint32_t    visited;        //  visited registry size
+    uint64_t    bytes;          //  memory taken by the search
+    double      seconds;        //  time since the start
+    double      phase_seconds[(int)search_phase::count];    //  time per phase, if timed
+
+    //  expansion count at which the total cost rose to every new value
+    std::vector<std::pair<float, uint64_t>> f_progression;
+};
+
+//  collects search_stats, reports them every progress_period expansions;
+//  PhaseTimers adds the phase timing (two clock reads per phase)
+template <bool PhaseTimers = false>
+class stats_observer {
+public:
+    static constexpr bool enabled = true;
+
+    stats_observer() : _stats(), _period(0), _start(std::chrono::steady_clock::now()) {}
+
+    //  the phase timer, no-op if not PhaseTimers
+    class timer {
+    public:
+        timer(stats_observer& obs, search_phase phase) : _obs(obs), _phase(phase) {
+            if (PhaseTimers) _start = std::chrono::steady_clock::now();
+        }
+
+        ~timer() {
+            if (PhaseTimers) {
+                _obs._stats.phase_seconds[(int)_phase] +=
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+            }
+        }
+
+    private:
+        stats_observer&                         _obs;
+        search_phase                            _phase;
+        std::chrono::steady_clock::time_point   _start;
+    };
+
+    //  calls fn every period expansions
+    void set_progress(uint64_t period, const std::function<void(const search_stats&)>& fn) {
+        _period = period;
+        _progress = fn;
+    }
+
+    void on_expand(float total_cost, float) {
+        _stats.expanded++;
+        if (_stats.f_progression.empty() || total_cost > _stats.max_f) {
+            _stats.max_f = total_cost;
+            _stats.f_progression.emplace_back(total_cost, _stats.expanded);
+        }
+    }
+
+    void on_generate() { _stats.generated++; }
+    void on_duplicate() { _stats.duplicates++; }
+
+    void on_update(bool in_front) {
+        if (in_front) {
+            _stats.updated++;
+        } else {
+            _stats.reopened++;
+        }
+    }
+
+    void on_progress(size_t front_size, uint32_t num_visited, uint64_t bytes) {
+        _stats.front_size = front_size;
+        _stats.visited = num_visited;
+        _stats.bytes = bytes;
+        if (_period > 0 && _progress && _stats.expanded % _period == 0) _progress(stats());
+    }
+
+    const search_stats& stats() const {
+        _stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+        return _stats;
+    }
+
+private:
+    mutable search_stats                            _stats;
+    uint64_t                                        _period;    //  progress period, expansions
+    std::function<void(const search_stats&)>        _progress;  //  progress callback
+    std::chrono::steady_clock::time_point           _start;     //  observer creation time
+};
+
+#endif // __SEARCH_OBSERVER__
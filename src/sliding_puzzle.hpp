@@ -1,6 +1,17 @@
 #ifndef __SLIDING_PUZZLE__
 #define __SLIDING_PUZZLE__
-#include <functional>
+#include <cstring>
+#include <array>
+#include <memory>
+#include <string>
+#include <type_traits>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "zobrist.hpp"
+#include "pattern_db.hpp"
+#include "solution_cache.hpp"
 
 #include "astar.hpp"
 
@@ -23,8 +34,32 @@ struct offset {
 static constexpr offset DIR_OFFSETS[] = { { 1, 0 },{ 0, 1 },{ -1, 0 },{ 0, -1 } };
 static constexpr int NUM_DIR = 4;
 
+inline int popcount64(uint64_t v) {
+#ifdef _MSC_VER
+    return (int)__popcnt64(v);
+#else
+    return __builtin_popcountll(v);
+#endif
+}
+
 class sliding_puzzle {
 public:
+    //  heuristic modes: 
+    //      admissible  - number of the target pieces not at their target offsets
+    //      weighted    - weighted sum of the (unit step) distances of the target pieces
+    enum class heuristic { admissible, weighted };
+
+    //  default pattern database size limit, entries (4 bits each)
+    static constexpr uint64_t DEFAULT_PDB_ENTRIES = 1ull << 24;
+
+    //  search node cost resolution (see astar): half a move, the estimates of the weights 
+    //  other than the default one get rounded to it, the bucket queue orders them so anyway
+    static constexpr int cost_scale = 2;
+
+    sliding_puzzle() :
+        _heuristic_mode(heuristic::weighted), _heuristic_weight(0.5f), _symmetric(false), 
+        _num_ranks(0), _pack_bits(0), _pack_zobrist(0) {}
+
     struct piece {
         std::vector<uint32_t>   mask_rows;
         offset                  offs;      //  bounding box top left
@@ -40,10 +75,12 @@ public:
 
         void set(int8_t row, int8_t col) {
             mask_rows[row] |= 1 << col;
+            const int right = empty() ? col + 1 : std::max(offs.dx + width, col + 1);
+            const int bottom = empty() ? row + 1 : std::max(offs.dy + height, row + 1);
             offs.dx = std::min(offs.dx, col);
             offs.dy = std::min(offs.dy, row);
-            width = std::max(width, (int8_t)(col - offs.dx + 1));
-            height = std::max(height, (int8_t)(row - offs.dy + 1));
+            width = (int8_t)(right - offs.dx);
+            height = (int8_t)(bottom - offs.dy);
         }
 
         bool is_set(int8_t row, int8_t col) const {
@@ -52,22 +89,27 @@ public:
 
         bool empty() const { return width == 0 || height == 0; }
 
-        bool overlaps(const piece& p, const offset& poffs) const {
-            for (int i = 0; i < p.height; i++) {
-                int dx = poffs.dx - p.offs.dx;
-                auto row = p.mask_rows[i + p.offs.dy];
-                auto row_offs = dx > 0 ? (row << dx) : (row >> -dx);
-                if (mask_rows[i + poffs.dy] & row_offs) return true;
+        //  whether the pieces have the same shape (up to translation)
+        bool same_shape(const piece& p) const {
+            if (width != p.width || height != p.height) return false;
+            for (int i = 0; i < height; i++) {
+                if ((mask_rows[i + offs.dy] >> offs.dx) != (p.mask_rows[i + p.offs.dy] >> p.offs.dx)) {
+                    return false;
+                }
             }
-            return false;
+            return true;
         }
 
-        void xor_with(const piece& p, const offset& poffs) {
-            for (int i = 0; i < p.height; i++) {
-                int dx = poffs.dx - p.offs.dx;
-                auto row = p.mask_rows[i + p.offs.dy];
-                mask_rows[i + poffs.dy] ^= dx > 0 ? (row << dx) : (row >> -dx);
+        //  whether the piece is the left-right mirror image of the other one
+        bool mirrored_shape(const piece& p) const {
+            if (width != p.width || height != p.height) return false;
+            for (int i = 0; i < height; i++) {
+                for (int j = 0; j < width; j++) {
+                    if (is_set(i + offs.dy, j + offs.dx) != 
+                        p.is_set(i + p.offs.dy, width - 1 - j + p.offs.dx)) return false;
+                }
             }
+            return true;
         }
     };
 
@@ -75,16 +117,28 @@ public:
         uint8_t  piece_id;
         int8_t   dx;
         int8_t   dy;
+        int8_t   dst_shift;     //  for interchangeable pieces: the slot of the moved piece 
+                                //  after the move, relative to piece_id (see canonicalize())
+        uint8_t  mirror;        //  whether the position is mirrored after the move 
+                                //  (see mirror_position())
 
         bool operator == (const move& rhs) const {
             return piece_id == rhs.piece_id && dx == rhs.dx && dy == rhs.dy;
         }
     };
 
+    //  both position types carry the Zobrist hash of the piece offsets, 
+    //  which is updated incrementally by apply_move/unapply_move.
+    //  The hash keys are per piece class, so the hash does not depend on the order
+    //  of the interchangeable pieces
+
+    //  position with heap-allocated offsets, the fallback for more pieces than fixed_position 
+    //  is given room for (up to MAX_PIECES, see parse)
     struct position {
         std::vector<offset> offsets;
+        uint64_t            zobrist;
 
-        position(int npieces = 0) {
+        position(int npieces = 0) : zobrist(0) {
             if (npieces > 0) {
                 offsets.resize(npieces);
                 std::fill(offsets.begin(), offsets.end(), offset{ 0, 0 });
@@ -92,76 +146,284 @@ public:
         }
 
         size_t operator () () const {
-            size_t res = 0;
-            for (const auto& v : offsets) {
-                res = res*101 + *((const uint16_t*)&v);
-            }
-            return res;
+            return (size_t)zobrist;
         }
 
         bool operator ==(const position& rhs) const {
-            return memcmp(&offsets[0], &rhs.offsets[0], sizeof(offset)*offsets.size()) == 0;
+            return zobrist == rhs.zobrist &&
+                memcmp(&offsets[0], &rhs.offsets[0], sizeof(offset)*offsets.size()) == 0;
         }
     };
 
-    void get_moves(const position& pos, std::vector<move>& res) const {
-        const int npieces = _pieces.size();
-        piece mask(_rows, _cols);
-        for (int i = 0; i < npieces; i++) {
-            mask.xor_with(_pieces[i], pos.offsets[i]);
+    //  position with inline storage for up to MaxPieces pieces, trivially copyable.
+    //  Unused trailing offsets are kept zero, so they don't affect hashing/comparison
+    template <int MaxPieces>
+    struct fixed_position {
+        std::array<offset, MaxPieces>   offsets;
+        uint64_t                        zobrist;
+
+        fixed_position(int npieces = 0) : zobrist(0) {
+            assert(npieces <= MaxPieces);
+            offsets.fill(offset{ 0, 0 });
         }
 
-        std::vector<char> visited(_cols*_rows);
-        //  iterate through possible moves
-        for (int i = 0; i < npieces; i++) {
-            //  remove current piece from the mask
-            const piece& piece = _pieces[i];
-            mask.xor_with(piece, pos.offsets[i]);
-
-            //  gather all the accessible offsets for this piece recursively (depth first)
-            std::fill(visited.begin(), visited.end(), 0);
-            std::function<void(int8_t, int8_t)> gather_moves = [&](int8_t dx, int8_t dy) {
-                visited[(pos.offsets[i].dx + dx) + (pos.offsets[i].dy + dy)*_cols] = true;
-                for (int j = 0; j < NUM_DIR; j++) {
-                    int8_t dx1 = dx + DIR_OFFSETS[j].dx;
-                    int8_t dy1 = dy + DIR_OFFSETS[j].dy;
-                    offset offs = { pos.offsets[i].dx + dx1, pos.offsets[i].dy + dy1 };
-                    //  find if can move this piece in this direction
-                    bool in_bounds = (offs.dx >= 0) & (offs.dy >= 0) &
-                        (offs.dx + piece.width <= _cols) &
-                        (offs.dy + piece.height <= _rows);
-                    if (!in_bounds || visited[offs.dx + offs.dy*_cols] ||
-                        mask.overlaps(piece, { offs.dx, offs.dy })) continue;
-                    res.push_back({ (uint8_t)i, dx1, dy1 });
-                    gather_moves(dx1, dy1);
-                }
-            };
-            gather_moves(0, 0);
-            //  restore current piece in the mask
-            mask.xor_with(_pieces[i], pos.offsets[i]);
+        size_t operator () () const {
+            return (size_t)zobrist;
+        }
+
+        bool operator ==(const fixed_position& rhs) const {
+            return zobrist == rhs.zobrist &&
+                memcmp(&offsets[0], &rhs.offsets[0], sizeof(offsets)) == 0;
+        }
+    };
+
+    static_assert(std::is_trivially_copyable<fixed_position<16>>::value,
+        "Fixed position must be trivially copyable");
+
+    //  all the position-dependent methods are templated on the position type,
+    //  so the same puzzle can be searched with either position or fixed_position<N>
+
+    template <typename TPos>
+    void get_moves(const TPos& pos, std::vector<move>& res) const {
+        if (_words == 1) {
+            gather_moves<1>(pos, res);
+        } else {
+            gather_moves<0>(pos, res);
         }
     }
 
-    inline float get_cost(const position& pos, const move& m) const {
+    template <typename TPos>
+    inline float get_cost(const TPos& pos, const move& m) const {
         return 1.0f;
     }
 
-    inline float estimate_cost(const position& source) const {
-        const int npieces = source.offsets.size();
+    template <typename TPos>
+    inline float estimate_cost(const TPos& source) const {
+        uint16_t dist;
+        if (_solutions && _solutions->lookup(source.zobrist, dist)) return (float)dist;
         float res = 0.0f;
+        const int ntargets = (int)_target.size();
+        for (int i = 0; i < ntargets; i++) {
+            res += _heuristic_table[(size_t)i*_cells + cell(source.offsets[_target[i].piece_id])];
+        }
+        for (const auto& pdb : _pdbs) {
+            res = std::max(res, pdb->lookup(source));
+        }
+        return res;
+    }
+
+    //  Note that the unit step distance is non-admissible for the multi-step moves,
+    //  the weight is used to find a balance between closeness to the optimal solution 
+    //  and the search space size. The admissible mode guarantees optimal solutions.
+    void set_heuristic(heuristic mode, float weight = 0.5f) {
+        _heuristic_mode = mode;
+        _heuristic_weight = weight;
+        init_heuristic();
+    }
+
+    //  Pattern databases: exact distances in the abstracted puzzle, which only has 
+    //  the target pieces and some of the blockers on the board. Those are admissible, 
+    //  and the heuristic is the maximum of them and the distance tables above.
+    //  Every database is either loaded (memory-mapped) from the cache directory, 
+    //  or built and then saved there; no caching if the directory is empty.
+
+    //  adds the pattern database of the given pieces, which get completed with 
+    //  the target pieces and the pieces interchangeable with the given ones.
+    //  Returns false if the database would exceed max_entries
+    bool add_pattern_db(std::vector<uint8_t> pieces, const std::string& cache_dir = "",
+        uint64_t max_entries = DEFAULT_PDB_ENTRIES) {
+        const int npieces = (int)_pieces.size();
+        std::vector<bool> in_pattern(npieces, false);
         for (const auto& m : _target) {
-            const offset& offs = source.offsets[m.piece_id];
-            res += (float)(abs(offs.dx - m.dx) + abs(offs.dy - m.dy));
+            if (m.piece_id < npieces) in_pattern[m.piece_id] = true;
+        }
+        for (auto i : pieces) {
+            if (i >= npieces) continue;
+            for (auto j : _class_pieces[_piece_class[i]]) in_pattern[j] = true;
+        }
+        std::vector<pattern_db::piece_desc> desc;
+        for (int i = 0; i < npieces; i++) {
+            const piece& p = _pieces[i];
+            if (in_pattern[i] && !p.empty()) desc.push_back({ (uint8_t)i, p.width, p.height });
+        }
+        if (desc.empty() || pattern_entries(desc) > std::min<uint64_t>(max_entries, UINT32_MAX)) {
+            return false;
+        }
+
+        auto pdb = std::make_shared<pattern_db>(pattern_key(desc), _rows, _cols, desc);
+        const std::string path = cache_dir.empty() ? "" : pattern_db::file_name(cache_dir, pdb->key());
+        if (path.empty() || !pdb->load(path)) {
+            build_pattern_db(*pdb);
+            if (!path.empty()) pdb->save(path);
         }
-        
-        //  note that manhattan distance heuristics is non-admissible for complex moves
-        //  we mitigate it somewhat by lowering it down,
-        //  trying to find a balance between closeness to the optimal solution and
-        //  the search space size
-        return res/2;
+        _pdbs.push_back(pdb);
+        return true;
     }
 
-    inline bool is_target(const position& pos) const {
+    //  adds up to max_pdbs pattern databases, each with the target pieces and the blocker
+    //  pieces (classes of the interchangeable ones) not used by the previous databases, 
+    //  the ones covering the target area first, as many as fit into max_entries.
+    //  Returns the number of the databases added
+    int add_pattern_dbs(const std::string& cache_dir = "", 
+        uint64_t max_entries = DEFAULT_PDB_ENTRIES, int max_pdbs = 2) {
+        const int npieces = (int)_pieces.size();
+        std::vector<bool> in_target(npieces, false);
+        std::vector<uint64_t> target_area(_words, 0);
+        for (const auto& m : _target) {
+            if (m.piece_id >= npieces || _pieces[m.piece_id].empty()) continue;
+            in_target[m.piece_id] = true;
+            const uint64_t* pm = placement(m.piece_id, cell({ m.dx, m.dy }));
+            for (int w = 0; w < _words; w++) target_area[w] |= pm[w];
+        }
+
+        //  blocker classes, by the number of their pieces covering the target area
+        const position layout = get_layout();
+        std::vector<std::pair<int, int>> blockers;
+        const int nclasses = (int)_class_pieces.size();
+        for (int c = 0; c < nclasses; c++) {
+            const auto& cls = _class_pieces[c];
+            if (in_target[cls[0]] || _pieces[cls[0]].empty()) continue;
+            int score = 0;
+            for (auto i : cls) {
+                const uint64_t* pm = placement(i, cell(layout.offsets[i]));
+                for (int w = 0; w < _words; w++) {
+                    if (pm[w] & target_area[w]) {
+                        score++;
+                        break;
+                    }
+                }
+            }
+            blockers.push_back({ -score, c });
+        }
+        std::sort(blockers.begin(), blockers.end());
+
+        int res = 0;
+        std::vector<bool> used(nclasses, false);
+        while (res < max_pdbs) {
+            std::vector<pattern_db::piece_desc> desc;
+            for (int i = 0; i < npieces; i++) {
+                if (in_target[i]) desc.push_back({ (uint8_t)i, _pieces[i].width, _pieces[i].height });
+            }
+            std::vector<uint8_t> pieces;
+            for (const auto& b : blockers) {
+                if (used[b.second]) continue;
+                auto desc1 = desc;
+                for (auto i : _class_pieces[b.second]) {
+                    desc1.push_back({ i, _pieces[i].width, _pieces[i].height });
+                }
+                if (pattern_entries(desc1) > max_entries) continue;
+                desc.swap(desc1);
+                used[b.second] = true;
+                pieces.push_back(_class_pieces[b.second][0]);
+            }
+            if (res > 0 && pieces.empty()) break;
+            if (!add_pattern_db(pieces, cache_dir, max_entries)) break;
+            res++;
+        }
+        return res;
+    }
+
+    const std::vector<std::shared_ptr<const pattern_db>>& pattern_dbs() const { return _pdbs; }
+
+    //  Solved positions: the cached exact distances to the target (see solution_cache.hpp) 
+    //  are used as the heuristic, and a search reaching a cached position is done 
+    //  (known_solution), so the searches from the other starting positions of the board 
+    //  stop at the paths solved before. Only exact (optimal) solutions should be recorded.
+
+    //  hash of everything the position hashes and the distances depend on: the board size, 
+    //  the pieces' shapes and the target, but not their layout
+    uint64_t board_key() const {
+        uint64_t res = 0xCBF29CE484222325ull;
+        auto add = [&res](int64_t v) {
+            for (int i = 0; i < 8; i++, v >>= 8) {
+                res = (res ^ (uint8_t)v)*0x100000001B3ull;
+            }
+        };
+        add(_rows);
+        add(_cols);
+        const int npieces = (int)_pieces.size();
+        for (int i = 0; i < npieces; i++) {
+            const piece& p = _pieces[i];
+            if (p.empty()) continue;
+            add(i);
+            add(p.width);
+            add(p.height);
+            for (int j = 0; j < p.height; j++) add(p.mask_rows[j + p.offs.dy] >> p.offs.dx);
+        }
+        for (const auto& m : _target) {
+            add(m.piece_id);
+            add(m.dx);
+            add(m.dy);
+        }
+        return res;
+    }
+
+    //  hash of the heuristic configuration the estimates depend on besides the board: 
+    //  the mode, the weight (of the weighted one) and the pattern databases' pieces
+    uint64_t heuristic_key() const {
+        uint64_t res = 0xCBF29CE484222325ull;
+        auto add = [&res](int64_t v) {
+            for (int i = 0; i < 8; i++, v >>= 8) {
+                res = (res ^ (uint8_t)v)*0x100000001B3ull;
+            }
+        };
+        add((int)_heuristic_mode);
+        if (_heuristic_mode == heuristic::weighted) {
+            uint32_t bits;
+            memcpy(&bits, &_heuristic_weight, sizeof(bits));
+            add(bits);
+        }
+        for (const auto& pdb : _pdbs) {
+            add(-1);
+            for (const auto& p : pdb->pieces()) add(p.id);
+        }
+        return res;
+    }
+
+    //  the cache must not be changed while searching
+    void set_solution_cache(std::shared_ptr<const solution_cache> cache) { _solutions = cache; }
+    const std::shared_ptr<const solution_cache>& solutions() const { return _solutions; }
+
+    //  the moves from a cached position to the target: every one to the successor 
+    //  a move closer to the target
+    template <typename TPos>
+    bool known_solution(const TPos& pos, std::vector<move>& res) const {
+        uint16_t dist;
+        if (!_solutions || !_solutions->lookup(pos.zobrist, dist)) return false;
+        res.clear();
+        std::vector<move> moves;
+        TPos cur = pos, succ;
+        for (; dist > 0; dist--) {
+            moves.clear();
+            get_moves(cur, moves);
+            auto it = std::find_if(moves.begin(), moves.end(), [&](const move& m) {
+                apply_move(cur, m, succ);
+                uint16_t d;
+                return (dist == 1) ? is_target(succ) : _solutions->lookup(succ.zobrist, d) && d == dist - 1;
+            });
+            if (it == moves.end()) break;
+            res.push_back(*it);
+            cur = succ;
+        }
+        if (dist == 0 && is_target(cur)) return true;
+        res.clear();
+        return false;
+    }
+
+    //  adds the positions of the solution (of the resolved moves, from the layout) to the cache
+    void record_solution(solution_cache& cache, const std::vector<move>& moves) const {
+        position pos = get_layout();
+        const int n = (int)moves.size();
+        for (int i = 0; i <= n; i++) {
+            //  the hash of the canonical position, which may be the mirror image
+            const uint64_t hash = _symmetric ? std::min(pos.zobrist, mirror_hash(pos)) : pos.zobrist;
+            cache.add(hash, (uint16_t)(n - i));
+            if (i < n) apply_move(pos, moves[i], pos);
+        }
+    }
+
+    template <typename TPos>
+    inline bool is_target(const TPos& pos) const {
         for (const auto& m : _target) {
             const offset& offs = pos.offsets[m.piece_id];
             if (offs.dx != m.dx || offs.dy != m.dy) return false;
@@ -169,59 +431,325 @@ public:
         return true;
     }
 
-    inline void apply_move(const position& pos, const move& m, position& new_pos) const {
+    template <typename TPos>
+    inline void apply_move(const TPos& pos, const move& m, TPos& new_pos) const {
         new_pos = pos;
-        offset& offs = new_pos.offsets[m.piece_id];
-        offs.dx += m.dx;
-        offs.dy += m.dy;
+        move_piece(new_pos, m.piece_id, m.piece_id + m.dst_shift, m.dx, m.dy);
+        if (m.mirror) mirror_position(new_pos);
     }
 
-    inline void unapply_move(const position& pos, const move& m, position& new_pos) const {
+    template <typename TPos>
+    inline void unapply_move(const TPos& pos, const move& m, TPos& new_pos) const {
         new_pos = pos;
-        offset& offs = new_pos.offsets[m.piece_id];
-        offs.dx -= m.dx;
-        offs.dy -= m.dy;
+        if (m.mirror) mirror_position(new_pos);
+        move_piece(new_pos, m.piece_id + m.dst_shift, m.piece_id, -m.dx, -m.dy);
     }
 
-    position get_source() const {
+    //  the initial position, as laid out in the puzzle file
+    template <typename TPos = position>
+    TPos get_layout() const {
         const size_t npieces = _pieces.size();
-        position res(npieces);
-        for (size_t i = 0; i < npieces; i++) res.offsets[i] = _pieces[i].offs;
+        TPos res((int)npieces);
+        for (size_t i = 0; i < npieces; i++) {
+            const offset& offs = _pieces[i].offs;
+            res.offsets[i] = offs;
+            if (!_pieces[i].empty()) res.zobrist ^= zobrist_keys(i)[cell(offs)];
+        }
         return res;
     }
 
-    void parse(std::istream& is) {
-        std::string line;
-        std::vector<std::string> lines;
+    //  takes the layout of the other puzzle of the same board (see board_key()), read or parsed, 
+    //  keeping the tables precomputed for this one
+    void set_layout(const sliding_puzzle& other) {
+        assert(other.board_key() == board_key());
+        _pieces = other._pieces;
+    }
 
-        _cols = 0;
-        bool is_source = false;
-        while (std::getline(is, line)) {
-            if (line.empty()) {
-                is_source = true;
-                break;
+    //  whether the other puzzle of the same board has the same layout
+    bool same_layout(const sliding_puzzle& other) const {
+        if (other._pieces.size() != _pieces.size()) return false;
+        for (size_t i = 0; i < _pieces.size(); i++) {
+            if (!(other._pieces[i].offs == _pieces[i].offs)) return false;
+        }
+        return true;
+    }
+
+    //  the initial position to start the search from (canonicalized layout)
+    template <typename TPos = position>
+    TPos get_source() const {
+        TPos res = get_layout<TPos>();
+        canonicalize(res);
+        if (_symmetric && mirror_hash(res) < res.zobrist) mirror_position(res);
+        return res;
+    }
+
+    //  the target position, if the target specifies all the pieces (canonicalized as the source)
+    template <typename TPos = position>
+    bool get_target(TPos& res) const {
+        res = get_layout<TPos>();
+        const size_t npieces = _pieces.size();
+        std::vector<bool> in_target(npieces, false);
+        for (const auto& m : _target) {
+            if (m.piece_id >= npieces) continue;
+            res.offsets[m.piece_id] = { m.dx, m.dy };
+            in_target[m.piece_id] = true;
+        }
+        res.zobrist = 0;
+        for (size_t i = 0; i < npieces; i++) {
+            if (_pieces[i].empty()) continue;
+            if (!in_target[i]) return false;
+            res.zobrist ^= zobrist_keys(i)[cell(res.offsets[i])];
+        }
+        canonicalize(res);
+        if (_symmetric && mirror_hash(res) < res.zobrist) mirror_position(res);
+        return true;
+    }
+
+    //  estimated cost between the two positions, in the same heuristic mode as estimate_cost
+    //  (meant for the fully specified targets, with no interchangeable pieces)
+    template <typename TPos>
+    float estimate_cost_to(const TPos& pos, const TPos& dst) const {
+        float res = piece_distances(pos, dst);
+        if (_symmetric) {
+            //  the position stands for its mirror image as well
+            TPos mirrored = pos;
+            mirror_position(mirrored);
+            res = std::min(res, piece_distances(mirrored, dst));
+        }
+        return res;
+    }
+
+    //  Pieces of the same shape which are not a part of the target are interchangeable.
+    //  In the canonical position their offsets are sorted (in the board cell order),
+    //  so the equivalent positions are hashed/compared as the same one. 
+    //  The moves generated from a canonical position keep it canonical 
+    //  by means of move::dst_shift
+    template <typename TPos>
+    void canonicalize(TPos& pos) const {
+        for (const auto& cls : _class_pieces) {
+            if (cls.size() < 2) continue;
+            offset offs[MAX_PIECES];
+            const int n = (int)cls.size();
+            for (int i = 0; i < n; i++) offs[i] = pos.offsets[cls[i]];
+            std::sort(offs, offs + n, [this](const offset& a, const offset& b) {
+                return cell(a) < cell(b);
+            });
+            for (int i = 0; i < n; i++) pos.offsets[cls[i]] = offs[i];
+        }
+    }
+
+    //  If the board and the target are left-right symmetric, a position and its mirror 
+    //  image are folded into a single one: of the two, the one with the lower hash is used.
+    //  The moves generated from such a position flag whether the resulting position 
+    //  gets mirrored (move::mirror)
+    template <typename TPos>
+    void mirror_position(TPos& pos) const {
+        const uint64_t zobrist = mirror_hash(pos);
+        offset offs[MAX_PIECES];
+        const int npieces = (int)_pieces.size();
+        std::copy(&pos.offsets[0], &pos.offsets[0] + npieces, offs);
+        for (int i = 0; i < npieces; i++) {
+            if (_pieces[i].empty()) continue;
+            pos.offsets[_mirror_piece[i]] = mirror_offset(i, offs[i]);
+        }
+        canonicalize(pos);
+        pos.zobrist = zobrist;
+    }
+
+    bool is_symmetric() const { return _symmetric; }
+
+    //  Ranks the canonical positions to the distinct integers in [0, num_ranks()): 
+    //  mixed radix of the placement combinations of every piece class, the single cell 
+    //  pieces last, their cells chosen among the ones not covered by the other pieces 
+    //  (which keeps the ranks much denser than all the placements of all the pieces).
+    //  num_ranks() is 0 if the ranks don't fit 63 bits
+    uint64_t num_ranks() const { return _num_ranks; }
+
+    template <typename TPos>
+    uint64_t rank(const TPos& pos) const {
+        const uint64_t* binom = binomials();
+        uint64_t occupied[MAX_BOARD_WORDS] = {};
+        uint64_t res = 0;
+        for (const auto& rc : _rank_classes) {
+            const auto& cls = _class_pieces[rc.cls];
+            const int k = (int)cls.size();
+            uint64_t digit = 0;
+            for (int i = 0; i < k; i++) {
+                const offset& offs = pos.offsets[cls[i]];
+                const int c = cell(offs);
+                //  the offset index, or the number of the free cells before
+                const int place = rc.on_cells ? c - count_below(occupied, c) :
+                    offs.dx + offs.dy*(_cols - _pieces[cls[i]].width + 1);
+                digit += binom[place*BINOM_K + i + 1];
             }
-            lines.push_back(line);
-            _cols = std::max(_cols, (int)line.size());
+            for (int i = 0; i < k; i++) {
+                const uint64_t* pm = placement(cls[i], cell(pos.offsets[cls[i]]));
+                for (int w = 0; w < _words; w++) occupied[w] |= pm[w];
+            }
+            res = res*rc.radix + digit;
         }
+        return res;
+    }
 
-        _rows = lines.size();
-        for (int i = 0; i < _rows; i++) {
-            const std::string& line = lines[i];
-            for (int j = 0; j < (int)line.size(); j++) {
-                char c = line[j];
-                int pid = (c <= '9') ? c - '0' : c - 'A' + 10;
-                if (pid < 0) continue;
-                if ((int)_pieces.size() <= pid)
-                    _pieces.resize(pid + 1, sliding_puzzle::piece(_rows, _cols));
-                _pieces[pid].set(i, j);
+    //  the position of the given rank, false if its pieces overlap
+    template <typename TPos>
+    bool unrank(uint64_t r, TPos& res) const {
+        const uint64_t* binom = binomials();
+        res = get_layout<TPos>();
+        const int nclasses = (int)_rank_classes.size();
+        uint64_t digits[MAX_PIECES];
+        for (int j = nclasses - 1; j >= 0; j--) {
+            digits[j] = r % _rank_classes[j].radix;
+            r /= _rank_classes[j].radix;
+        }
+
+        uint64_t occupied[MAX_BOARD_WORDS] = {};
+        int places[MAX_PIECES];
+        int cells[MAX_PIECES];
+        for (int j = 0; j < nclasses; j++) {
+            const rank_class& rc = _rank_classes[j];
+            const auto& cls = _class_pieces[rc.cls];
+            const int k = (int)cls.size();
+            //  the combination, largest place first
+            uint64_t digit = digits[j];
+            int place = rc.num_places;
+            for (int i = k - 1; i >= 0; i--) {
+                do place--; while (binom[place*BINOM_K + i + 1] > digit);
+                places[i] = place;
+                digit -= binom[place*BINOM_K + i + 1];
+            }
+            if (rc.on_cells) {
+                //  the places are the indices among the free cells
+                for (int c = 0, nfree = 0, i = 0; c < _cells && i < k; c++) {
+                    if (occupied[c >> 6] & (1ull << (c & 63))) continue;
+                    if (nfree++ == places[i]) cells[i++] = c;
+                }
+            } else {
+                const int w = _cols - _pieces[cls[0]].width + 1;
+                for (int i = 0; i < k; i++) cells[i] = places[i]%w + places[i]/w*_cols;
+            }
+            for (int i = 0; i < k; i++) {
+                const uint64_t* pm = placement(cls[i], cells[i]);
+                uint64_t overlap = 0;
+                for (int w = 0; w < _words; w++) {
+                    overlap |= occupied[w] & pm[w];
+                    occupied[w] |= pm[w];
+                }
+                if (overlap) return false;
+                res.offsets[cls[i]] = { (int8_t)(cells[i]%_cols), (int8_t)(cells[i]/_cols) };
             }
         }
 
-        //  parse the target part
-        if (is_source) {
+        res.zobrist = 0;
+        const int npieces = (int)_pieces.size();
+        for (int i = 0; i < npieces; i++) {
+            if (!_pieces[i].empty()) res.zobrist ^= zobrist_keys(i)[cell(res.offsets[i])];
+        }
+        return true;
+    }
+
+    //  the searches keep the positions packed: the place (offset index) of every piece 
+    //  in as many bits as it needs, if those fit 64 bits, or else the rank, if it fits
+    template <typename TPos>
+    bool pack_position(const TPos& pos, uint64_t& res) const {
+        if (_pack_bits > 64) {
+            if (_num_ranks == 0) return false;
+            res = rank(pos);
+            return true;
+        }
+        res = 0;
+        for (const auto& pf : _pack_fields) {
+            const offset& offs = pos.offsets[pf.piece_id];
+            res |= (uint64_t)(offs.dx + offs.dy*pf.row_places) << pf.shift;
+        }
+        return true;
+    }
+
+    template <typename TPos>
+    void unpack_position(uint64_t packed, TPos& res) const {
+        if (_pack_bits > 64) {
+            unrank(packed, res);
+            return;
+        }
+        const int npieces = (int)_pieces.size();
+        if ((int)res.offsets.size() < npieces) res = TPos(npieces);
+        //  the pieces which can't move stay at their layout offsets
+        for (int i = 0; i < npieces; i++) res.offsets[i] = _pieces[i].offs;
+        res.zobrist = _pack_zobrist;
+        for (const auto& pf : _pack_fields) {
+            const uint32_t place = (uint32_t)(packed >> pf.shift) & ((1u << pf.bits) - 1);
+            const offset offs = _place_offsets[pf.places + place];
+            res.offsets[pf.piece_id] = offs;
+            res.zobrist ^= zobrist_keys(pf.piece_id)[cell(offs)];
+        }
+    }
+
+    //  converts the moves found from the canonical source position into moves of 
+    //  the individual pieces (with zero dst_shift, not mirrored). The pieces are identified 
+    //  as in the layout if the source is the canonical layout, and as in the source otherwise
+    template <typename TPos>
+    void resolve_moves(const TPos& source, std::vector<move>& moves) const {
+        TPos pos = source;
+        TPos real = get_layout<TPos>();
+        TPos canonical = real;
+        canonicalize(canonical);
+        //  whether the canonical position is the mirror image of the real one
+        bool mirrored = false;
+        if (!(canonical == source)) {
+            if (_symmetric) mirror_position(canonical);
+            if (_symmetric && canonical == source) {
+                mirrored = true;
+            } else {
+                real = source;
+            }
+        }
+        for (auto& m : moves) {
+            int pid = m.piece_id;
+            offset offs = pos.offsets[pid];
+            int8_t dx = m.dx;
+            if (mirrored) {
+                offs = mirror_offset(pid, offs);
+                pid = _mirror_piece[pid];
+                dx = -dx;
+            }
+            uint8_t id = (uint8_t)pid;
+            for (auto j : _class_pieces[_piece_class[pid]]) {
+                if (real.offsets[j] == offs) {
+                    id = j;
+                    break;
+                }
+            }
+            apply_move(pos, m, pos);
+            mirrored ^= (m.mirror != 0);
+            m = { id, dx, m.dy, 0, 0 };
+            apply_move(real, m, real);
+        }
+    }
+
+    int num_pieces() const { return (int)_pieces.size(); }
+
+    //  reads the layout and the target (after an empty line); fails on the puzzles out of 
+    //  the limits, the reason in error: the piece ids are '0'-'9' and 'A'-'Z' (MAX_PIECES),
+    //  the board up to MAX_BOARD_CELLS cells, 31 columns (the piece masks) and 127 rows 
+    //  (the offsets), and at least a piece. The puzzle is not usable if it fails
+    bool parse(std::istream& is, std::string& error) {
+        if (!read(is, error)) return false;
+        init_classes();
+        init_placements();
+        init_symmetry();
+        init_target_distances();
+        init_ranking();
+        return true;
+    }
+
+    //  reads the puzzle as parse does, without the precomputation: enough for board_key() 
+    //  and set_layout(), not for searching
+    bool read(std::istream& is, std::string& error) {
+        bool has_target = false;
+        if (!read_pieces(is, error, has_target)) return false;
+        if (has_target) {
             sliding_puzzle target;
-            target.parse(is);
+            if (!target.read_pieces(is, error, has_target)) return false;
             uint8_t nt = (uint8_t)target._pieces.size();
             for (uint8_t i = 0; i < nt; i++) {
                 const piece& p = target._pieces[i];
@@ -230,7 +758,16 @@ public:
                 }
             }
         }
-        
+        if (std::all_of(_pieces.begin(), _pieces.end(), [](const piece& p) { return p.empty(); })) {
+            error = "no pieces";
+            return false;
+        }
+        return true;
+    }
+
+    bool parse(std::istream& is) {
+        std::string error;
+        return parse(is, error);
     }
 
     static std::string move_str(const sliding_puzzle::move& move) {
@@ -258,9 +795,613 @@ public:
     }
 
 private:
-    std::vector<piece>  _pieces;
-    std::vector<move>   _target;
-    int                 _rows, _cols;
+    static constexpr int MAX_BOARD_CELLS = 1024;
+    static constexpr int MAX_BOARD_WORDS = MAX_BOARD_CELLS/64;
+    static constexpr int MAX_BOARD_COLS = 31;
+    static constexpr int MAX_BOARD_ROWS = 127;
+    static constexpr int MAX_PIECES = 36;
+
+    std::vector<piece>      _pieces;
+    std::vector<move>       _target;
+    int                     _rows, _cols;
+
+    //  interchangeable piece classes
+    std::vector<uint8_t>                _piece_class;   //  class of every piece
+    std::vector<uint8_t>                _class_rank;    //  index of the piece in its class
+    std::vector<std::vector<uint8_t>>   _class_pieces;  //  pieces of every class, ascending
+
+    //  placement bitboards: for every piece and every board cell as the piece offset,
+    //  the mask of the board cells covered by the piece (_words 64-bit words per mask),
+    //  zero for the offsets where the piece does not fit the board
+    std::vector<uint64_t>   _placements;
+    int                     _cells;
+    int                     _words;
+
+    //  Zobrist keys for every piece class and every board cell as the piece offset
+    std::vector<uint64_t>   _zobrist;
+
+    //  heuristic distance tables for every target piece and every board cell as its offset
+    heuristic               _heuristic_mode;
+    float                   _heuristic_weight;
+    std::vector<uint16_t>   _target_steps;      //  distance in unit steps
+    std::vector<float>      _heuristic_table;   //  distance for the current heuristic mode
+
+    //  left-right mirror symmetry
+    bool                    _symmetric;         //  whether the board/target are symmetric
+    std::vector<uint8_t>    _mirror_piece;      //  slot of the mirror image of every piece
+    std::vector<uint64_t>   _zobrist_mirror;    //  keys of the mirrored placements, per class/cell
+
+    std::vector<std::shared_ptr<const pattern_db>>  _pdbs;  //  pattern databases
+    std::shared_ptr<const solution_cache>           _solutions;  //  solved positions, if any
+
+    //  position ranking, the piece classes in the ranking order
+    struct rank_class {
+        uint8_t     cls;            //  piece class
+        bool        on_cells;       //  single cell pieces, placed on the free cells
+        int         num_places;     //  number of the offsets (free cells) to choose from
+        uint64_t    radix;          //  number of the placement combinations
+    };
+    std::vector<rank_class> _rank_classes;
+    uint64_t                _num_ranks;
+
+    //  packed positions (see pack_position), the place fields of the pieces which can move
+    struct pack_field {
+        uint8_t     piece_id;
+        uint8_t     bits;
+        uint8_t     shift;
+        uint8_t     row_places;         //  number of the places in a row
+        uint32_t    places;             //  the offsets of the places in _place_offsets
+    };
+    std::vector<pack_field> _pack_fields;
+    std::vector<offset>     _place_offsets;
+    int                     _pack_bits;         //  total size of the fields
+    uint64_t                _pack_zobrist;      //  hash of the pieces which can't move
+
+    //  binomial coefficients C(n, k) for n <= MAX_BOARD_CELLS, k < BINOM_K, saturated
+    static constexpr int BINOM_K = MAX_PIECES + 1;
+
+    static const uint64_t* binomials() {
+        static const std::vector<uint64_t> table = [] {
+            std::vector<uint64_t> res((size_t)(MAX_BOARD_CELLS + 1)*BINOM_K, 0);
+            for (int n = 0; n <= MAX_BOARD_CELLS; n++) {
+                res[n*BINOM_K] = 1;
+                for (int k = 1; k < BINOM_K && k <= n; k++) {
+                    const uint64_t a = res[(n - 1)*BINOM_K + k - 1];
+                    const uint64_t b = res[(n - 1)*BINOM_K + k];
+                    res[n*BINOM_K + k] = (a + b < a) ? UINT64_MAX : a + b;
+                }
+            }
+            return res;
+        }();
+        return &table[0];
+    }
+
+    //  number of the set bits before the given one
+    inline int count_below(const uint64_t* bits, int bit) const {
+        int res = 0;
+        for (int w = 0; w < (bit >> 6); w++) res += popcount64(bits[w]);
+        return res + popcount64(bits[bit >> 6] & ((1ull << (bit & 63)) - 1));
+    }
+
+    inline const uint64_t* placement(int piece_id, int cell) const {
+        return &_placements[((size_t)piece_id*_cells + cell)*_words];
+    }
+
+    inline const uint64_t* zobrist_keys(int piece_id) const {
+        return &_zobrist[(size_t)_piece_class[piece_id]*_cells];
+    }
+
+    inline int cell(const offset& offs) const {
+        return offs.dx + offs.dy*_cols;
+    }
+
+    inline offset mirror_offset(int piece_id, const offset& offs) const {
+        return{ (int8_t)(_cols - _pieces[piece_id].width - offs.dx), offs.dy };
+    }
+
+    //  hash of the mirror image of the position
+    template <typename TPos>
+    inline uint64_t mirror_hash(const TPos& pos) const {
+        uint64_t res = 0;
+        const int npieces = (int)_pieces.size();
+        for (int i = 0; i < npieces; i++) {
+            if (_pieces[i].empty()) continue;
+            res ^= _zobrist_mirror[(size_t)_piece_class[i]*_cells + cell(pos.offsets[i])];
+        }
+        return res;
+    }
+
+    //  sum of the heuristic piece distances, alone on the board the unit step distance
+    //  is the Manhattan one
+    template <typename TPos>
+    float piece_distances(const TPos& pos, const TPos& dst) const {
+        float res = 0.0f;
+        const int npieces = (int)_pieces.size();
+        for (int i = 0; i < npieces; i++) {
+            if (_pieces[i].empty()) continue;
+            const int steps = abs(pos.offsets[i].dx - dst.offsets[i].dx) + 
+                abs(pos.offsets[i].dy - dst.offsets[i].dy);
+            if (steps == 0) continue;
+            res += (_heuristic_mode == heuristic::admissible) ? 1.0f : _heuristic_weight*steps;
+        }
+        return res;
+    }
+
+    //  moves piece from slot src by (dx, dy) into slot dst, 
+    //  shifting the interchangeable pieces between the slots
+    template <typename TPos>
+    inline void move_piece(TPos& pos, int src, int dst, int dx, int dy) const {
+        offset offs = pos.offsets[src];
+        const uint64_t* keys = zobrist_keys(src);
+        pos.zobrist ^= keys[cell(offs)];
+        offs.dx += dx;
+        offs.dy += dy;
+        pos.zobrist ^= keys[cell(offs)];
+        if (src != dst) {
+            const auto& cls = _class_pieces[_piece_class[src]];
+            int rs = _class_rank[src];
+            const int rd = _class_rank[dst];
+            for (; rs < rd; rs++) pos.offsets[cls[rs]] = pos.offsets[cls[rs + 1]];
+            for (; rs > rd; rs--) pos.offsets[cls[rs]] = pos.offsets[cls[rs - 1]];
+        }
+        pos.offsets[dst] = offs;
+    }
+
+    //  the slot the piece moved to the given cell gets in the canonical position
+    template <typename TPos>
+    inline int canonical_slot(const TPos& pos, int piece_id, int to_cell) const {
+        const auto& cls = _class_pieces[_piece_class[piece_id]];
+        if (cls.size() < 2) return piece_id;
+        int rank = 0;
+        for (auto j : cls) {
+            if (j != piece_id && cell(pos.offsets[j]) < to_cell) rank++;
+        }
+        return cls[rank];
+    }
+
+    //  reads the board lines up to an empty one (has_target) or the end
+    bool read_pieces(std::istream& is, std::string& error, bool& has_target) {
+        std::string line;
+        std::vector<std::string> lines;
+
+        _cols = 0;
+        has_target = false;
+        while (std::getline(is, line)) {
+            if (line.empty()) {
+                has_target = true;
+                break;
+            }
+            lines.push_back(line);
+            _cols = std::max(_cols, (int)line.size());
+        }
+
+        _rows = lines.size();
+        if (_cols > MAX_BOARD_COLS || _rows > MAX_BOARD_ROWS || _rows*_cols > MAX_BOARD_CELLS) {
+            std::stringstream ss;
+            ss << "the board of " << _cols << "x" << _rows << " is too large, the boards are up to " << 
+                MAX_BOARD_COLS << " columns, " << MAX_BOARD_ROWS << " rows and " << MAX_BOARD_CELLS << " cells";
+            error = ss.str();
+            return false;
+        }
+        for (int i = 0; i < _rows; i++) {
+            const std::string& line = lines[i];
+            for (int j = 0; j < (int)line.size(); j++) {
+                char c = line[j];
+                int pid = (c <= '9') ? c - '0' : (c >= 'A') ? c - 'A' + 10 : MAX_PIECES;
+                if (pid < 0) continue;
+                if (pid >= MAX_PIECES) {
+                    error = std::string("invalid piece '") + c + "', the pieces are '0'-'9' and 'A'-'Z'";
+                    return false;
+                }
+                if ((int)_pieces.size() <= pid)
+                    _pieces.resize(pid + 1, sliding_puzzle::piece(_rows, _cols));
+                _pieces[pid].set(i, j);
+            }
+        }
+        return true;
+    }
+
+    void init_classes() {
+        const int npieces = (int)_pieces.size();
+        assert(npieces <= MAX_PIECES);
+        std::vector<bool> in_target(npieces, false);
+        for (const auto& m : _target) {
+            if (m.piece_id < npieces) in_target[m.piece_id] = true;
+        }
+        _piece_class.assign(npieces, 0);
+        _class_rank.assign(npieces, 0);
+        _class_pieces.clear();
+        for (int i = 0; i < npieces; i++) {
+            int c = 0;
+            const int nclasses = (int)_class_pieces.size();
+            for (; c < nclasses; c++) {
+                const int j = _class_pieces[c][0];
+                if (!in_target[i] && !in_target[j] && !_pieces[i].empty() && 
+                    !_pieces[j].empty() && _pieces[i].same_shape(_pieces[j])) break;
+            }
+            if (c == nclasses) _class_pieces.push_back({});
+            _piece_class[i] = (uint8_t)c;
+            _class_rank[i] = (uint8_t)_class_pieces[c].size();
+            _class_pieces[c].push_back((uint8_t)i);
+        }
+    }
+
+    void init_placements() {
+        _cells = _rows*_cols;
+        assert(_cells <= MAX_BOARD_CELLS);
+        _words = (_cells + 63)/64;
+        const int npieces = (int)_pieces.size();
+        _placements.assign((size_t)npieces*_cells*_words, 0);
+        zobrist_fill(_zobrist, _class_pieces.size()*_cells);
+        for (int i = 0; i < npieces; i++) {
+            const piece& p = _pieces[i];
+            if (p.empty()) continue;
+            for (int oy = 0; oy + p.height <= _rows; oy++) {
+                for (int ox = 0; ox + p.width <= _cols; ox++) {
+                    uint64_t* pm = &_placements[((size_t)i*_cells + ox + oy*_cols)*_words];
+                    for (int py = 0; py < p.height; py++) {
+                        for (int px = 0; px < p.width; px++) {
+                            if (!p.is_set(py + p.offs.dy, px + p.offs.dx)) continue;
+                            const int bit = (ox + px) + (oy + py)*_cols;
+                            pm[bit >> 6] |= 1ull << (bit & 63);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void init_ranking() {
+        const uint64_t* binom = binomials();
+        _rank_classes.clear();
+        int free_cells = _cells;
+        const int nclasses = (int)_class_pieces.size();
+        for (int c = 0; c < nclasses; c++) {
+            const piece& p = _pieces[_class_pieces[c][0]];
+            if (p.empty() || (p.width == 1 && p.height == 1)) continue;
+            const int num_places = (_cols - p.width + 1)*(_rows - p.height + 1);
+            _rank_classes.push_back({ (uint8_t)c, false, num_places, 
+                binom[num_places*BINOM_K + _class_pieces[c].size()] });
+            int area = 0;
+            for (auto row : p.mask_rows) area += popcount64(row);
+            free_cells -= area*(int)_class_pieces[c].size();
+        }
+        for (int c = 0; c < nclasses; c++) {
+            const piece& p = _pieces[_class_pieces[c][0]];
+            if (p.empty() || p.width != 1 || p.height != 1) continue;
+            const int k = (int)_class_pieces[c].size();
+            free_cells = std::max(free_cells, 0);
+            _rank_classes.push_back({ (uint8_t)c, true, free_cells, binom[free_cells*BINOM_K + k] });
+            free_cells -= k;
+        }
+        _num_ranks = 1;
+        for (const auto& rc : _rank_classes) {
+            if (rc.radix == 0 || _num_ranks > (1ull << 63)/rc.radix) {
+                _num_ranks = 0;
+                break;
+            }
+            _num_ranks *= rc.radix;
+        }
+
+        _pack_fields.clear();
+        _place_offsets.clear();
+        _pack_bits = 0;
+        _pack_zobrist = 0;
+        const int npieces = (int)_pieces.size();
+        for (int i = 0; i < npieces; i++) {
+            const piece& p = _pieces[i];
+            if (p.empty()) continue;
+            const int row_places = _cols - p.width + 1;
+            const int num_places = row_places*(_rows - p.height + 1);
+            if (num_places == 1) {
+                _pack_zobrist ^= zobrist_keys(i)[cell(p.offs)];
+                continue;
+            }
+            pack_field pf = { (uint8_t)i, 0, (uint8_t)std::min(_pack_bits, 64), (uint8_t)row_places, 
+                (uint32_t)_place_offsets.size() };
+            while ((1 << pf.bits) < num_places) pf.bits++;
+            for (int place = 0; place < num_places; place++) {
+                _place_offsets.push_back({ (int8_t)(place%row_places), (int8_t)(place/row_places) });
+            }
+            _pack_fields.push_back(pf);
+            _pack_bits += pf.bits;
+        }
+    }
+
+    //  distances from every offset to the target one, for every target piece,
+    //  found by breadth first search of the piece alone on the board
+    void init_target_distances() {
+        const uint16_t UNREACHABLE = 0xFFFF;
+        const int ntargets = (int)_target.size();
+        _target_steps.assign((size_t)ntargets*_cells, UNREACHABLE);
+        std::vector<offset> queue;
+        for (int i = 0; i < ntargets; i++) {
+            const move& t = _target[i];
+            if (t.piece_id >= _pieces.size()) continue;
+            const piece& p = _pieces[t.piece_id];
+            uint16_t* dist = &_target_steps[(size_t)i*_cells];
+            queue.clear();
+            queue.push_back({ t.dx, t.dy });
+            dist[cell(queue[0])] = 0;
+            for (size_t head = 0; head < queue.size(); head++) {
+                const offset offs = queue[head];
+                for (int j = 0; j < NUM_DIR; j++) {
+                    const offset offs1 = offs + DIR_OFFSETS[j];
+                    if (offs1.dx < 0 || offs1.dy < 0 || 
+                        offs1.dx + p.width > _cols || offs1.dy + p.height > _rows) continue;
+                    if (dist[cell(offs1)] != UNREACHABLE) continue;
+                    dist[cell(offs1)] = dist[cell(offs)] + 1;
+                    queue.push_back(offs1);
+                }
+            }
+        }
+        init_heuristic();
+    }
+
+    void init_heuristic() {
+        _heuristic_table.resize(_target_steps.size());
+        for (size_t i = 0; i < _target_steps.size(); i++) {
+            const uint16_t steps = _target_steps[i];
+            if (_heuristic_mode == heuristic::admissible) {
+                //  alone on the board, the piece gets anywhere reachable in a single move;
+                //  as every move moves a single piece, the sum over the pieces is admissible
+                _heuristic_table[i] = (steps == 0) ? 0.0f : 1.0f;
+            } else {
+                _heuristic_table[i] = _heuristic_weight*steps;
+            }
+        }
+    }
+
+    //  finds the left-right mirror image for every piece class, 
+    //  the puzzle is symmetric if there is one for every class
+    void init_symmetry() {
+        const int npieces = (int)_pieces.size();
+        const int nclasses = (int)_class_pieces.size();
+        _symmetric = false;
+        _mirror_piece.resize(npieces);
+        for (int i = 0; i < npieces; i++) _mirror_piece[i] = (uint8_t)i;
+
+        //  target offset for every piece, if any
+        auto find_target = [this](int piece_id) -> const move* {
+            for (const auto& m : _target) {
+                if (m.piece_id == piece_id) return &m;
+            }
+            return nullptr;
+        };
+
+        std::vector<int> class_mirror(nclasses, -1);
+        for (int c = 0; c < nclasses; c++) {
+            const auto& cls = _class_pieces[c];
+            const piece& p = _pieces[cls[0]];
+            if (p.empty()) {
+                class_mirror[c] = c;
+                continue;
+            }
+            const move* t = find_target(cls[0]);
+            for (int c1 = 0; c1 < nclasses; c1++) {
+                const auto& cls1 = _class_pieces[c1];
+                const piece& p1 = _pieces[cls1[0]];
+                if (cls1.size() != cls.size() || p1.empty() || !p.mirrored_shape(p1)) continue;
+                const move* t1 = find_target(cls1[0]);
+                if ((t == nullptr) != (t1 == nullptr)) continue;
+                if (t && (t1->dy != t->dy || t1->dx != _cols - p.width - t->dx)) continue;
+                class_mirror[c] = c1;
+                break;
+            }
+            if (class_mirror[c] < 0) return;
+        }
+
+        _zobrist_mirror.assign((size_t)nclasses*_cells, 0);
+        for (int c = 0; c < nclasses; c++) {
+            const auto& cls = _class_pieces[c];
+            const auto& cls1 = _class_pieces[class_mirror[c]];
+            for (size_t k = 0; k < cls.size(); k++) _mirror_piece[cls[k]] = cls1[k];
+            const piece& p = _pieces[cls[0]];
+            if (p.empty()) continue;
+            for (int oy = 0; oy + p.height <= _rows; oy++) {
+                for (int ox = 0; ox + p.width <= _cols; ox++) {
+                    _zobrist_mirror[(size_t)c*_cells + cell({ (int8_t)ox, (int8_t)oy })] =
+                        _zobrist[(size_t)class_mirror[c]*_cells + (_cols - p.width - ox) + oy*_cols];
+                }
+            }
+        }
+        _symmetric = true;
+    }
+
+    //  number of the abstract positions of the pattern
+    uint64_t pattern_entries(const std::vector<pattern_db::piece_desc>& desc) const {
+        uint64_t res = 1;
+        for (const auto& d : desc) res *= (uint64_t)(_cols - d.width + 1)*(_rows - d.height + 1);
+        return res;
+    }
+
+    //  hash of everything the pattern database depends on: 
+    //  the board size, the pattern pieces' shapes and their targets
+    uint64_t pattern_key(const std::vector<pattern_db::piece_desc>& desc) const {
+        uint64_t res = 0xCBF29CE484222325ull;
+        auto add = [&res](int64_t v) {
+            for (int i = 0; i < 8; i++, v >>= 8) {
+                res = (res ^ (uint8_t)v)*0x100000001B3ull;
+            }
+        };
+        add(_rows);
+        add(_cols);
+        for (const auto& d : desc) {
+            const piece& p = _pieces[d.id];
+            add(p.width);
+            add(p.height);
+            for (int i = 0; i < p.height; i++) add(p.mask_rows[i + p.offs.dy] >> p.offs.dx);
+            offset t = { -1, -1 };
+            for (const auto& m : _target) {
+                if (m.piece_id == d.id) t = { m.dx, m.dy };
+            }
+            add(t.dx);
+            add(t.dy);
+        }
+        return res;
+    }
+
+    //  the abstracted puzzle with the pattern pieces only (renumbered in the pattern order)
+    sliding_puzzle pattern_puzzle(const std::vector<pattern_db::piece_desc>& desc) const {
+        sliding_puzzle res;
+        res._rows = _rows;
+        res._cols = _cols;
+        const int n = (int)desc.size();
+        for (int k = 0; k < n; k++) {
+            res._pieces.push_back(_pieces[desc[k].id]);
+            for (const auto& m : _target) {
+                if (m.piece_id == desc[k].id) res._target.push_back({ (uint8_t)k, m.dx, m.dy });
+            }
+        }
+        res.init_classes();
+        res.init_placements();
+        res._mirror_piece.resize(n);
+        for (int k = 0; k < n; k++) res._mirror_piece[k] = (uint8_t)k;
+        return res;
+    }
+
+    //  Fills the pattern database by breadth first search in the abstracted puzzle, 
+    //  backwards from all its target positions (as the moves are reversible, 
+    //  that is the same as searching forward). Only the canonical positions are ranked;
+    //  the distances of pattern_db::MAX_DIST and more are stored as MAX_DIST
+    void build_pattern_db(pattern_db& pdb) const {
+        const sliding_puzzle sub = pattern_puzzle(pdb.pieces());
+        const int n = (int)pdb.pieces().size();
+        pdb.alloc();
+
+        std::vector<uint32_t> layer, next;
+        position pos(n), pos1(n);
+        std::vector<uint64_t> occupied(sub._words, 0);
+        sub.gather_targets(pdb, 0, pos, occupied, layer);
+        for (auto r : layer) pdb.set(r, 0);
+
+        std::vector<move> moves;
+        const auto set_offset = [&pos](int k, int dx, int dy) {
+            pos.offsets[k] = { (int8_t)dx, (int8_t)dy };
+        };
+        const auto get_offset = [&pos1](int k) { return pos1.offsets[k]; };
+        for (uint8_t d = 1; d < pattern_db::MAX_DIST && !layer.empty(); d++) {
+            next.clear();
+            for (auto r : layer) {
+                pdb.unrank(r, set_offset);
+                moves.clear();
+                sub.get_moves(pos, moves);
+                for (const auto& m : moves) {
+                    sub.apply_move(pos, m, pos1);
+                    const uint64_t r1 = pdb.rank(get_offset);
+                    if (pdb.get(r1) != pattern_db::MAX_DIST) continue;
+                    pdb.set(r1, d);
+                    next.push_back((uint32_t)r1);
+                }
+            }
+            layer.swap(next);
+        }
+    }
+
+    //  gathers the ranks of all the canonical target positions of the abstracted puzzle, 
+    //  placing the pieces from k on
+    void gather_targets(const pattern_db& pdb, int k, position& pos, 
+        std::vector<uint64_t>& occupied, std::vector<uint32_t>& res) const {
+        if (k == (int)_pieces.size()) {
+            res.push_back((uint32_t)pdb.rank([&pos](int i) { return pos.offsets[i]; }));
+            return;
+        }
+        const piece& p = _pieces[k];
+        int min_cell = 0;
+        if (_class_rank[k] > 0) {
+            min_cell = cell(pos.offsets[_class_pieces[_piece_class[k]][_class_rank[k] - 1]]) + 1;
+        }
+        const move* t = nullptr;
+        for (const auto& m : _target) {
+            if (m.piece_id == k) t = &m;
+        }
+        for (int oy = 0; oy + p.height <= _rows; oy++) {
+            for (int ox = 0; ox + p.width <= _cols; ox++) {
+                if (t && (ox != t->dx || oy != t->dy)) continue;
+                const int c = ox + oy*_cols;
+                if (c < min_cell) continue;
+                const uint64_t* pm = placement(k, c);
+                bool overlap = false;
+                for (int w = 0; w < _words; w++) overlap |= (pm[w] & occupied[w]) != 0;
+                if (overlap) continue;
+                for (int w = 0; w < _words; w++) occupied[w] |= pm[w];
+                pos.offsets[k] = { (int8_t)ox, (int8_t)oy };
+                gather_targets(pdb, k + 1, pos, occupied, res);
+                for (int w = 0; w < _words; w++) occupied[w] ^= pm[w];
+            }
+        }
+    }
+
+    //  gathers all the offsets accessible by every piece (breadth first), 
+    //  W is the number of the bitboard words if known at compile time, 0 otherwise
+    template <int W, typename TPos>
+    void gather_moves(const TPos& pos, std::vector<move>& res) const {
+        const int nw = W ? W : _words;
+        const int npieces = (int)_pieces.size();
+
+        uint64_t occupied[W ? W : MAX_BOARD_WORDS] = {};
+        for (int i = 0; i < npieces; i++) {
+            if (_pieces[i].empty()) continue;
+            const uint64_t* pm = placement(i, pos.offsets[i].dx + pos.offsets[i].dy*_cols);
+            for (int w = 0; w < nw; w++) occupied[w] |= pm[w];
+        }
+
+        //  hashes of the position and its mirror image, to find the mirrored successors
+        const uint64_t zobrist0 = pos.zobrist;
+        const uint64_t zobrist_mirror0 = _symmetric ? mirror_hash(pos) : 0;
+
+        uint64_t others[W ? W : MAX_BOARD_WORDS];
+        uint64_t visited[W ? W : MAX_BOARD_WORDS];
+        offset queue[MAX_BOARD_CELLS];
+        for (int i = 0; i < npieces; i++) {
+            const piece& p = _pieces[i];
+            if (p.empty()) continue;
+
+            //  occupancy mask without the current piece
+            const offset offs0 = pos.offsets[i];
+            const int cell0 = offs0.dx + offs0.dy*_cols;
+            const uint64_t* pm0 = placement(i, cell0);
+            for (int w = 0; w < nw; w++) {
+                others[w] = occupied[w] ^ pm0[w];
+                visited[w] = 0;
+            }
+            visited[cell0 >> 6] |= 1ull << (cell0 & 63);
+
+            int head = 0, tail = 0;
+            queue[tail++] = offs0;
+            while (head < tail) {
+                const offset offs = queue[head++];
+                for (int j = 0; j < NUM_DIR; j++) {
+                    const int x = offs.dx + DIR_OFFSETS[j].dx;
+                    const int y = offs.dy + DIR_OFFSETS[j].dy;
+                    if (x < 0 || y < 0 || x + p.width > _cols || y + p.height > _rows) continue;
+                    const int cell = x + y*_cols;
+                    const uint64_t bit = 1ull << (cell & 63);
+                    if (visited[cell >> 6] & bit) continue;
+                    visited[cell >> 6] |= bit;
+
+                    //  find if the piece can be placed here
+                    const uint64_t* pm = placement(i, cell);
+                    uint64_t overlap = 0;
+                    for (int w = 0; w < nw; w++) overlap |= pm[w] & others[w];
+                    if (overlap) continue;
+
+                    const int dst = canonical_slot(pos, i, cell);
+                    uint8_t mirror = 0;
+                    if (_symmetric) {
+                        const size_t base = (size_t)_piece_class[i]*_cells;
+                        const uint64_t z = zobrist0 ^ _zobrist[base + cell0] ^ _zobrist[base + cell];
+                        const uint64_t zm = zobrist_mirror0 ^ 
+                            _zobrist_mirror[base + cell0] ^ _zobrist_mirror[base + cell];
+                        mirror = zm < z;
+                    }
+                    res.push_back({ (uint8_t)i, (int8_t)(x - offs0.dx), (int8_t)(y - offs0.dy),
+                        (int8_t)(dst - i), mirror });
+                    queue[tail++] = { (int8_t)x, (int8_t)y };
+                }
+            }
+        }
+    }
 
     friend class sliding_puzzle_svg;
 };
@@ -0,0 +1,162 @@
+#ifndef __SOLUTION_CACHE__
+#define __SOLUTION_CACHE__
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include "mapped_file.hpp"
+
+//  Solved position store of a board: the exact distances to the target of the positions
+//  on the optimal solution paths found so far, keyed by the 64-bit position hashes.
+//
+//  The file is the sorted hashes followed by their distances (10 bytes per position),
+//  memory-mapped and binary searched; the positions added since go to an in-memory table
+//  and are merged into the file by save(). The file name is the key of the board (a hash of
+//  everything the position hashes and the distances depend on, see sliding_puzzle::board_key).
+//  A search gets the best move of a stored position by stepping to the successor one closer.
+class solution_cache {
+public:
+    solution_cache(uint64_t key = 0) : _key(key), _hashes(nullptr), _dists(nullptr), _count(0) {}
+
+    solution_cache(const solution_cache&) = delete;
+    solution_cache& operator =(const solution_cache&) = delete;
+
+    uint64_t key() const { return _key; }
+    //  number of the positions stored (the ones improved since the load counted twice until saved)
+    size_t size() const { return _count + _added.size(); }
+    bool is_mapped() const { return _file.is_open(); }
+
+    inline bool lookup(uint64_t hash, uint16_t& dist) const {
+        if (!_added.empty()) {
+            auto it = _added.find(hash);
+            if (it != _added.end()) {
+                dist = it->second;
+                return true;
+            }
+        }
+        const uint64_t* p = std::lower_bound(_hashes, _hashes + _count, hash);
+        if (p == _hashes + _count || *p != hash) return false;
+        dist = _dists[p - _hashes];
+        return true;
+    }
+
+    //  keeps the shorter distance if the position is stored already
+    void add(uint64_t hash, uint16_t dist) {
+        uint16_t d;
+        if (lookup(hash, d) && d <= dist) return;
+        _added[hash] = dist;
+    }
+
+    static std::string file_name(const std::string& dir, uint64_t key) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%016llx.spsc", (unsigned long long)key);
+        return dir.empty() ? std::string(buf) : dir + "/" + buf;
+    }
+
+    //  merges the added positions in and writes the file (unmapping the loaded one first)
+    bool save(const std::string& path) {
+        merge();
+        FILE* f = fopen(path.c_str(), "wb");
+        if (!f) return false;
+        const header h = make_header();
+        bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+            fwrite(_hashes, sizeof(uint64_t), _count, f) == _count &&
+            fwrite(_dists, sizeof(uint16_t), _count, f) == _count;
+        ok = (fclose(f) == 0) && ok;
+        return ok;
+    }
+
+    //  memory-maps the file in place of the sorted positions (the added ones are kept),
+    //  fails if it is not of the same board
+    bool load(const std::string& path) {
+        header h;
+        {
+            mapped_file file;
+            if (!file.open(path) || file.size() < sizeof(header)) return false;
+            memcpy(&h, file.data(), sizeof(h));
+            const header expected = make_header();
+            if (memcmp(h.magic, expected.magic, sizeof(h.magic)) != 0 || h.version != expected.version ||
+                h.key != _key || file.size() != sizeof(header) + h.count*(sizeof(uint64_t) + sizeof(uint16_t))) {
+                return false;
+            }
+        }
+        _mem_hashes.clear();
+        _mem_dists.clear();
+        if (!_file.open(path)) {
+            _count = 0;
+            return false;
+        }
+        _count = (size_t)h.count;
+        _hashes = (const uint64_t*)(_file.data() + sizeof(header));
+        _dists = (const uint16_t*)(_hashes + _count);
+        return true;
+    }
+
+private:
+    struct header {
+        char        magic[4];
+        uint32_t    version;
+        uint64_t    key;
+        uint64_t    count;
+    };
+
+    //  bumped to drop the files of the earlier versions, which could record the solutions 
+    //  of the searches resumed from a checkpoint (not necessarily optimal) as exact
+    static constexpr uint32_t VERSION = 2;
+
+    uint64_t                _key;           //  board key
+    const uint64_t*         _hashes;        //  sorted hashes, either in memory or memory-mapped
+    const uint16_t*         _dists;         //  their distances
+    size_t                  _count;         //  number of the sorted positions
+    std::vector<uint64_t>   _mem_hashes;    //  in-memory sorted hashes (after a merge)
+    std::vector<uint16_t>   _mem_dists;
+    mapped_file             _file;          //  memory-mapped store file
+
+    std::unordered_map<uint64_t, uint16_t>  _added;    //  positions added since the load/merge
+
+    header make_header() const {
+        header h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, "SPSC", 4);
+        h.version = VERSION;
+        h.key = _key;
+        h.count = _count;
+        return h;
+    }
+
+    //  merges the added positions into the in-memory sorted arrays
+    void merge() {
+        std::vector<std::pair<uint64_t, uint16_t>> added(_added.begin(), _added.end());
+        std::sort(added.begin(), added.end());
+        std::vector<uint64_t> hashes;
+        std::vector<uint16_t> dists;
+        hashes.reserve(_count + added.size());
+        dists.reserve(_count + added.size());
+        size_t i = 0, j = 0;
+        while (i < _count || j < added.size()) {
+            if (j == added.size() || (i < _count && _hashes[i] < added[j].first)) {
+                hashes.push_back(_hashes[i]);
+                dists.push_back(_dists[i++]);
+            } else {
+                //  the added distances are the shorter ones
+                if (i < _count && _hashes[i] == added[j].first) i++;
+                hashes.push_back(added[j].first);
+                dists.push_back(added[j++].second);
+            }
+        }
+        _added.clear();
+        _file.close();
+        _mem_hashes.swap(hashes);
+        _mem_dists.swap(dists);
+        _count = _mem_hashes.size();
+        _hashes = _mem_hashes.data();
+        _dists = _mem_dists.data();
+    }
+};
+
+#endif // __SOLUTION_CACHE__
@@ -0,0 +1,276 @@
+#ifndef __SOLVE_SERVICE__
+#define __SOLVE_SERVICE__
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+
+#include "sliding_puzzle.hpp"
+#include "astar.hpp"
+
+//  Sliding puzzle solving for the many requests (the batch and server tools).
+//
+//  The boards (the parsed puzzles, with their heuristic tables and pattern databases) are
+//  cached by sliding_puzzle::board_key() and the options they depend on, so that the requests
+//  for any layout of a board skip the precomputation (a layout other than the one the board
+//  was parsed with is searched on a copy of the board taking it). The solutions are cached
+//  per board by the layout, so that the repeated requests skip the search; the concurrent
+//  requests for the same layout wait for the one search in progress. Searches stopped by 
+//  the limits are not cached. The least recently used boards are dropped beyond max_boards.
+
+struct solve_options {
+    std::string heuristic;                  //  admissible or weighted
+    float       weight      = 0.5f;         //  Manhattan distance scale of the weighted heuristic
+    std::string pdb_dir;                    //  pattern databases cache directory
+    uint64_t    pdb_size    = 0;            //  pattern database size limit (entries), 0 for none
+    double      time_limit  = 0.0;          //  per search (seconds), 0 for none
+    uint64_t    max_memory  = 0;            //  per search (MB), 0 for none
+};
+
+struct solve_result {
+    std::string                         status;     //  search_status, or the error
+    std::string                         error;      //  error description
+    std::vector<sliding_puzzle::move>   moves;
+    double                              seconds;    //  search time (of the original search if cached)
+    uint64_t                            expanded;
+    uint32_t                            visited;
+    bool                                cached;     //  whether the solution came from the cache
+
+    solve_result() : seconds(0.0), expanded(0), visited(0), cached(false) {}
+};
+
+inline const char* search_status_str(search_status status) {
+    switch (status) {
+    case search_status::solved:             return "solved";
+    case search_status::no_solution:        return "no_solution";
+    case search_status::expansion_limit:    return "expansion_limit";
+    case search_status::time_limit:         return "time_limit";
+    case search_status::memory_limit:       return "memory_limit";
+    }
+    return "";
+}
+
+inline std::string json_str(const std::string& str) {
+    std::string res = "\"";
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            res += '\\';
+            res += c;
+        } else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", (int)c);
+            res += buf;
+        } else {
+            res += c;
+        }
+    }
+    return res + "\"";
+}
+
+//  the result as a JSON object, following the given leading fields (e.g. "\"id\":1")
+inline std::string result_json(const std::string& fields, solve_result res) {
+    std::ostringstream ss;
+    ss << "{" << fields << (fields.empty() ? "" : ",") << "\"status\":" << json_str(res.status);
+    if (!res.error.empty()) ss << ",\"error\":" << json_str(res.error);
+    if (res.status == "solved") {
+        ss << ",\"length\":" << res.moves.size() << ",\"moves\":" << json_str(sliding_puzzle::moves_str(res.moves));
+    }
+    ss << ",\"seconds\":" << res.seconds << ",\"expanded\":" << res.expanded << ",\"visited\":" << res.visited;
+    if (res.cached) ss << ",\"cached\":true";
+    ss << "}";
+    return ss.str();
+}
+
+template <typename TPos>
+void solve_puzzle(const sliding_puzzle& sp, const solve_options& opt, solve_result& res) {
+    astar<sliding_puzzle, TPos> solver(sp, sp.get_source<TPos>());
+    search_limits limits;
+    limits.max_seconds = opt.time_limit;
+    limits.max_bytes = opt.max_memory << 20;
+    const search_status status = solver.solve(limits);
+    res.status = search_status_str(status);
+    if (status == search_status::solved) solver.get_solution(res.moves);
+    res.expanded = solver.num_expanded();
+    res.visited = solver.num_visited();
+}
+
+//  solves with A*, using the smallest inline position type that fits the pieces
+inline void solve_puzzle(const sliding_puzzle& sp, const solve_options& opt, solve_result& res) {
+    using namespace std::chrono;
+    const auto start = steady_clock::now();
+    const int npieces = sp.num_pieces();
+    if (npieces <= 8) {
+        solve_puzzle<sliding_puzzle::fixed_position<8>>(sp, opt, res);
+    } else if (npieces <= 16) {
+        solve_puzzle<sliding_puzzle::fixed_position<16>>(sp, opt, res);
+    } else if (npieces <= 32) {
+        solve_puzzle<sliding_puzzle::fixed_position<32>>(sp, opt, res);
+    } else {
+        solve_puzzle<sliding_puzzle::position>(sp, opt, res);
+    }
+    res.seconds = duration<double>(steady_clock::now() - start).count();
+}
+
+class solve_service {
+public:
+    struct stats {
+        uint64_t    requests;       //  solve() calls
+        uint64_t    board_hits;     //  requests with the board cached
+        uint64_t    solution_hits;  //  requests with the solution cached (or in progress)
+        size_t      boards;         //  boards cached
+    };
+
+    //  max_boards = 0 for no limit
+    explicit solve_service(size_t max_boards = 0) : _max_boards(max_boards), _tick(0), _stats() {}
+
+    solve_service(const solve_service&) = delete;
+    solve_service& operator =(const solve_service&) = delete;
+
+    //  the parsed board of the puzzle with the heuristic set up, cached; null if not valid
+    std::shared_ptr<const sliding_puzzle> board(const std::string& text, const solve_options& opt) {
+        sliding_puzzle request;
+        std::string error;
+        const std::string puzzle = strip_cr(text);
+        std::istringstream is(puzzle);
+        return request.read(is, error) ? get_entry(request, puzzle, opt)->board : nullptr;
+    }
+
+    //  the solution, cached; text is the puzzle file contents
+    solve_result solve(const std::string& text, const solve_options& opt) {
+        solve_result res;
+        sliding_puzzle request;
+        const std::string puzzle = strip_cr(text);
+        std::istringstream is(puzzle);
+        if (!request.read(is, res.error)) {
+            res.status = "error";
+            return res;
+        }
+        std::shared_ptr<entry> e = get_entry(request, puzzle, opt);
+
+        std::promise<solve_result> promise;
+        std::shared_future<solve_result> solution;
+        bool owner = false;
+        {
+            std::lock_guard<std::mutex> lock(e->mutex);
+            std::shared_future<solve_result>& slot = e->solutions[puzzle];
+            if (!slot.valid()) {
+                slot = promise.get_future().share();
+                owner = true;
+            }
+            solution = slot;
+        }
+        if (!owner) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stats.solution_hits++;
+        } else {
+            if (e->board->same_layout(request)) {
+                solve_puzzle(*e->board, opt, res);
+            } else {
+                sliding_puzzle sp(*e->board);
+                sp.set_layout(request);
+                solve_puzzle(sp, opt, res);
+            }
+            if (res.status != "solved" && res.status != "no_solution") {
+                //  stopped by the limits, the next request searches again
+                std::lock_guard<std::mutex> lock(e->mutex);
+                e->solutions.erase(puzzle);
+            }
+            promise.set_value(res);
+            return res;
+        }
+        res = solution.get();
+        res.cached = true;
+        return res;
+    }
+
+    stats get_stats() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        stats res = _stats;
+        res.boards = _entries.size();
+        return res;
+    }
+
+private:
+    struct entry {
+        std::shared_ptr<const sliding_puzzle>   board;
+        std::once_flag                          parsed;     //  the board is built once
+        std::mutex                              mutex;      //  guards solutions
+        //  the complete (or in progress) searches, by the puzzle text (without carriage returns)
+        std::map<std::string, std::shared_future<solve_result>> solutions;
+        uint64_t                                last_used;  //  tick of the last request
+    };
+
+    size_t                                          _max_boards;
+    std::map<std::string, std::shared_ptr<entry>>   _entries;   //  by the board key
+    uint64_t                                        _tick;      //  request counter
+    stats                                           _stats;
+    mutable std::mutex                              _mutex;     //  guards the above
+
+    static std::string strip_cr(const std::string& text) {
+        std::string res;
+        for (char c : text) {
+            if (c != '\r') res += c;
+        }
+        return res;
+    }
+
+    //  the board (not the layout) and the options the precomputation depends on
+    static std::string board_key(const sliding_puzzle& sp, const solve_options& opt) {
+        std::ostringstream ss;
+        ss << std::hex << sp.board_key() << std::dec << ' ' << (opt.heuristic == "admissible" ? 'a' : 'w') << 
+            opt.weight << ' ' << opt.pdb_size << ' ' << opt.pdb_dir;
+        return ss.str();
+    }
+
+    //  request is the read puzzle, the board parsed from its text if not cached
+    std::shared_ptr<entry> get_entry(const sliding_puzzle& request, const std::string& text, 
+        const solve_options& opt) {
+        const std::string key = board_key(request, opt);
+        std::shared_ptr<entry> e;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stats.requests++;
+            auto& slot = _entries[key];
+            if (slot) {
+                _stats.board_hits++;
+            } else {
+                slot = std::make_shared<entry>();
+            }
+            slot->last_used = ++_tick;
+            e = slot;
+            evict();
+        }
+
+        //  built outside of the service lock, the other requests for it wait
+        std::call_once(e->parsed, [&] {
+            auto sp = std::make_shared<sliding_puzzle>();
+            std::istringstream is(text);
+            //  can't fail once read
+            sp->parse(is);
+            sp->set_heuristic(opt.heuristic == "admissible" ?
+                sliding_puzzle::heuristic::admissible : sliding_puzzle::heuristic::weighted, opt.weight);
+            if (opt.pdb_size > 0) sp->add_pattern_dbs(opt.pdb_dir, opt.pdb_size);
+            e->board = sp;
+        });
+        return e;
+    }
+
+    //  drops the least recently used board beyond the limit (still alive while in use)
+    void evict() {
+        if (_max_boards == 0 || _entries.size() <= _max_boards) return;
+        auto lru = _entries.end();
+        for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+            if (lru == _entries.end() || it->second->last_used < lru->second->last_used) lru = it;
+        }
+        _entries.erase(lru);
+    }
+};
+
+#endif // __SOLVE_SERVICE__
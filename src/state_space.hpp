@@ -0,0 +1,248 @@
+#ifndef __STATE_SPACE__
+#define __STATE_SPACE__
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "sliding_puzzle.hpp"
+
+//  Exhaustive enumeration of the sliding puzzle positions reachable from the source.
+//
+//  Level synchronous breadth first search, the frontier split between the threads,
+//  the positions identified by their ranks (see sliding_puzzle::rank), visited ones
+//  marked in a bitmap of 1 bit per rank. After the enumeration, the reachable positions
+//  get the dense indices (the number of the reachable ranks below theirs, counted with
+//  a directory of the bitmap), and the distance to the nearest target position is found
+//  for every one by another breadth first search, backwards from all the target positions
+//  (the moves are reversible).
+class state_space {
+public:
+    static constexpr uint64_t NONE = UINT64_MAX;
+    static constexpr uint16_t UNREACHABLE = 0xFFFF;
+
+    state_space() : _board_key(0), _num_ranks(0), _num_states(0), _num_targets(0) {}
+
+    //  num_threads = 0 uses all the hardware threads
+    template <typename TPos>
+    bool enumerate(const sliding_puzzle& sp, const TPos& source, int num_threads = 0) {
+        _board_key = sp.board_key();
+        _num_ranks = sp.num_ranks();
+        if (_num_ranks == 0) return false;
+        if (num_threads <= 0) num_threads = std::max(1, (int)std::thread::hardware_concurrency());
+
+        const size_t nwords = (size_t)((_num_ranks + 63)/64);
+        std::unique_ptr<std::atomic<uint64_t>[]> visited(new std::atomic<uint64_t>[nwords]);
+        for (size_t i = 0; i < nwords; i++) visited[i].store(0, std::memory_order_relaxed);
+
+        //  forward, from the source
+        std::vector<uint64_t> targets;
+        std::vector<uint64_t> frontier(1, sp.rank(source));
+        visited[frontier[0] >> 6].fetch_or(1ull << (frontier[0] & 63));
+        if (sp.is_target(source)) targets.push_back(frontier[0]);
+        _histogram.clear();
+        while (!frontier.empty()) {
+            _histogram.push_back(frontier.size());
+            std::vector<std::vector<uint64_t>> found(num_threads);
+            std::vector<std::vector<uint64_t>> found_targets(num_threads);
+            expand_level<TPos>(sp, frontier, num_threads,
+                [&](int t, const TPos& pos, uint64_t r) {
+                    const uint64_t bit = 1ull << (r & 63);
+                    if (visited[r >> 6].fetch_or(bit, std::memory_order_relaxed) & bit) return;
+                    found[t].push_back(r);
+                    if (sp.is_target(pos)) found_targets[t].push_back(r);
+                });
+            frontier.clear();
+            for (int t = 0; t < num_threads; t++) {
+                frontier.insert(frontier.end(), found[t].begin(), found[t].end());
+                targets.insert(targets.end(), found_targets[t].begin(), found_targets[t].end());
+            }
+        }
+
+        _visited.resize(nwords);
+        for (size_t i = 0; i < nwords; i++) _visited[i] = visited[i].load(std::memory_order_relaxed);
+        visited.reset();
+        init_directory();
+        _num_targets = targets.size();
+
+        //  backward, from all the targets
+        std::unique_ptr<std::atomic<uint16_t>[]> dist(new std::atomic<uint16_t>[(size_t)_num_states]);
+        for (uint64_t i = 0; i < _num_states; i++) dist[i].store(UNREACHABLE, std::memory_order_relaxed);
+        for (auto r : targets) dist[index(r)].store(0, std::memory_order_relaxed);
+        frontier.swap(targets);
+        for (uint16_t level = 1; !frontier.empty() && level < UNREACHABLE; level++) {
+            std::vector<std::vector<uint64_t>> found(num_threads);
+            expand_level<TPos>(sp, frontier, num_threads,
+                [&](int t, const TPos&, uint64_t r) {
+                    uint16_t d = UNREACHABLE;
+                    if (dist[index(r)].compare_exchange_strong(d, level, std::memory_order_relaxed)) {
+                        found[t].push_back(r);
+                    }
+                });
+            frontier.clear();
+            for (int t = 0; t < num_threads; t++) {
+                frontier.insert(frontier.end(), found[t].begin(), found[t].end());
+            }
+        }
+        _to_target.resize((size_t)_num_states);
+        for (uint64_t i = 0; i < _num_states; i++) _to_target[i] = dist[i].load(std::memory_order_relaxed);
+        return true;
+    }
+
+    uint64_t num_ranks() const { return _num_ranks; }
+    uint64_t num_states() const { return _num_states; }
+    uint64_t num_targets() const { return _num_targets; }
+
+    //  largest distance from the source
+    int depth() const { return (int)_histogram.size() - 1; }
+    //  number of the positions at every distance from the source
+    const std::vector<uint64_t>& histogram() const { return _histogram; }
+
+    //  dense index of the reachable position with the given rank, NONE if it's not reachable
+    uint64_t index(uint64_t rank) const {
+        if (rank >= _num_ranks) return NONE;
+        const size_t w = (size_t)(rank >> 6);
+        const uint64_t bit = 1ull << (rank & 63);
+        if (!(_visited[w] & bit)) return NONE;
+        uint64_t res = _directory[w/BLOCK_WORDS];
+        for (size_t i = w & ~(size_t)(BLOCK_WORDS - 1); i < w; i++) res += popcount64(_visited[i]);
+        return res + popcount64(_visited[w] & (bit - 1));
+    }
+
+    //  distance to the nearest target position, UNREACHABLE if there is none
+    uint16_t distance_to_target(uint64_t index) const { return _to_target[(size_t)index]; }
+
+    //  largest distance to the nearest target position (of the ones which can reach it)
+    int max_distance_to_target() const {
+        int res = -1;
+        for (auto d : _to_target) {
+            if (d != UNREACHABLE) res = std::max(res, (int)d);
+        }
+        return res;
+    }
+
+    //  the visited bitmap, the histogram and the distances to the target
+    bool save(const std::string& path) const {
+        std::ofstream fs(path, std::ios::binary);
+        if (!fs.is_open()) return false;
+        const header h = { { 'S', 'P', 'S', 'S' }, VERSION, _board_key, _num_ranks, _num_states,
+            _num_targets, _histogram.size() };
+        fs.write((const char*)&h, sizeof(h));
+        write_vector(fs, _visited);
+        write_vector(fs, _histogram);
+        write_vector(fs, _to_target);
+        return fs.good();
+    }
+
+    //  fails (leaving the state space as it is) if the file was not saved for the board of sp
+    bool load(const std::string& path, const sliding_puzzle& sp) {
+        std::ifstream fs(path, std::ios::binary);
+        if (!fs.is_open()) return false;
+        header h;
+        if (!fs.read((char*)&h, sizeof(h)) || memcmp(h.magic, "SPSS", 4) != 0 ||
+            h.version != VERSION || h.board_key != sp.board_key() || h.num_ranks != sp.num_ranks() ||
+            h.num_states > h.num_ranks || h.depth > h.num_states) return false;
+        std::vector<uint64_t> visited((size_t)((h.num_ranks + 63)/64));
+        std::vector<uint64_t> histogram((size_t)h.depth);
+        std::vector<uint16_t> to_target((size_t)h.num_states);
+        if (!read_vector(fs, visited) || !read_vector(fs, histogram) || !read_vector(fs, to_target)) {
+            return false;
+        }
+        uint64_t count = 0;
+        for (auto w : visited) count += popcount64(w);
+        if (count != h.num_states) return false;
+
+        _board_key = h.board_key;
+        _num_ranks = h.num_ranks;
+        _num_targets = h.num_targets;
+        _visited.swap(visited);
+        _histogram.swap(histogram);
+        _to_target.swap(to_target);
+        init_directory();
+        return true;
+    }
+
+private:
+    static constexpr uint32_t VERSION = 2;
+    //  bitmap words per directory entry
+    static constexpr size_t BLOCK_WORDS = 8;
+    //  positions per frontier chunk taken by a thread at once
+    static constexpr size_t CHUNK = 256;
+
+    struct header {
+        char        magic[4];
+        uint32_t    version;
+        uint64_t    board_key;      //  sliding_puzzle::board_key() of the enumerated puzzle
+        uint64_t    num_ranks;
+        uint64_t    num_states;
+        uint64_t    num_targets;
+        uint64_t    depth;          //  number of the histogram entries
+    };
+
+    uint64_t                _board_key;
+    uint64_t                _num_ranks;
+    uint64_t                _num_states;
+    uint64_t                _num_targets;
+    std::vector<uint64_t>   _visited;       //  reachable ranks bitmap
+    std::vector<uint64_t>   _directory;     //  number of the reachable ranks before every block
+    std::vector<uint64_t>   _histogram;     //  number of the positions per distance from the source
+    std::vector<uint16_t>   _to_target;     //  distance to the target, per dense index
+
+    template <typename T>
+    static void write_vector(std::ostream& fs, const std::vector<T>& v) {
+        if (!v.empty()) fs.write((const char*)&v[0], v.size()*sizeof(T));
+    }
+
+    template <typename T>
+    static bool read_vector(std::istream& fs, std::vector<T>& v) {
+        return v.empty() || fs.read((char*)&v[0], v.size()*sizeof(T));
+    }
+
+    void init_directory() {
+        _directory.assign(_visited.size()/BLOCK_WORDS + 1, 0);
+        uint64_t count = 0;
+        for (size_t i = 0; i < _visited.size(); i++) {
+            if (i%BLOCK_WORDS == 0) _directory[i/BLOCK_WORDS] = count;
+            count += popcount64(_visited[i]);
+        }
+        _num_states = count;
+    }
+
+    //  calls visit(thread, successor, successor rank) for all the successors of the frontier,
+    //  the threads taking the frontier chunks in turn
+    template <typename TPos, typename TVisit>
+    static void expand_level(const sliding_puzzle& sp, const std::vector<uint64_t>& frontier,
+        int num_threads, TVisit visit) {
+        std::atomic<size_t> next(0);
+        auto worker = [&](int t) {
+            TPos pos, succ;
+            std::vector<sliding_puzzle::move> moves;
+            while (true) {
+                const size_t begin = next.fetch_add(CHUNK);
+                if (begin >= frontier.size()) break;
+                const size_t end = std::min(begin + CHUNK, frontier.size());
+                for (size_t i = begin; i < end; i++) {
+                    sp.unrank(frontier[i], pos);
+                    moves.clear();
+                    sp.get_moves(pos, moves);
+                    for (const auto& m : moves) {
+                        sp.apply_move(pos, m, succ);
+                        visit(t, succ, sp.rank(succ));
+                    }
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for (int t = 1; t < num_threads; t++) threads.emplace_back(worker, t);
+        worker(0);
+        for (auto& th : threads) th.join();
+    }
+};
+
+#endif // __STATE_SPACE__
@@ -3,8 +3,19 @@
 #include <iostream>
 
 #include <pool_alloc.hpp>
+#include <open_list.hpp>
+#include <closed_table.hpp>
+#include <node_arena.hpp>
 
 #include <astar.hpp>
+#include <idastar.hpp>
+#include <hdastar.hpp>
+#include <bidirectional.hpp>
+#include <arastar.hpp>
+#include <state_space.hpp>
+#include <external_search.hpp>
+#include <thread_pool.hpp>
+#include <solve_service.hpp>
 #include <gridmap.hpp>
 #include <npuzzle.hpp>
 #include <sliding_puzzle.hpp>
@@ -194,6 +205,75 @@ public:
         }
     }
 
+    TEST_METHOD(test_npuzzle_heuristics)
+    {
+        typedef npuzzle<3> np8;
+        auto pdb = std::make_shared<np8::pattern_db>();
+        Assert::IsTrue(pdb->generate({ { 1, 2, 3, 4 }, { 5, 6, 7, 8 } }));
+        Assert::IsFalse(np8::pattern_db().generate({ { 1, 2, 3 }, { 3, 4 } }));
+
+        //  memory-mapped copy of the tables
+        const std::string path = "npuzzle8.npdb";
+        Assert::IsTrue(pdb->save(path));
+        auto mapped = std::make_shared<np8::pattern_db>();
+        Assert::IsTrue(mapped->load(path));
+        Assert::AreEqual(2, (int)mapped->partition().size());
+
+        const char* tests[] = { "123745086", "126350478", "302651478", "876543210" };
+        const int min_moves[] = { 4, 13, 21, 30 };
+        for (int i = 0; i < 4; i++) {
+            std::array<int8_t, 9> start;
+            for (int j = 0; j < 9; j++) start[j] = tests[i][j] - '0';
+            const np8::position pos(&start[0]);
+
+            np8 np;
+            np.set_heuristic(np8::heuristic::manhattan);
+            const float manhattan = np.estimate_cost(pos);
+            np.set_heuristic(np8::heuristic::linear_conflict);
+            const float linear_conflict = np.estimate_cost(pos);
+            np.set_pattern_db(pdb);
+            const float pattern_db = np.estimate_cost(pos);
+            Assert::IsTrue(manhattan <= linear_conflict && linear_conflict <= pattern_db);
+            Assert::IsTrue(pattern_db <= min_moves[i]);
+
+            np8 np1;
+            np1.set_pattern_db(mapped);
+            Assert::AreEqual(pattern_db, np1.estimate_cost(pos));
+            astar<np8> solver(np1, pos);
+            solver.solve();
+            std::vector<np8::move> solution;
+            Assert::IsTrue(solver.get_solution(solution));
+            Assert::AreEqual(min_moves[i], (int)solution.size());
+
+            //  the incrementally updated Manhattan distance matches the one computed from scratch
+            np8::position pos1 = pos;
+            for (auto m : solution) np1.apply_move(pos1, m, pos1);
+            Assert::AreEqual(0, (int)pos1.manhattan);
+        }
+        mapped.reset();
+        std::remove(path.c_str());
+    }
+
+
+    TEST_METHOD(test_npuzzle_zobrist)
+    {
+        typedef npuzzle<3> np8;
+        np8 np;
+        const int8_t start[] = { 1, 2, 3, 4, 0, 5, 7, 8, 6 };
+        np8::position pos(start), pos1, pos2;
+
+        np.apply_move(pos, 1, pos1);
+        np.apply_move(pos1, 3, pos2);
+        //  the incrementally updated hash matches the one computed from scratch
+        Assert::IsTrue(np8::position(&pos2.cells[0]).zobrist == pos2.zobrist);
+        Assert::IsTrue(pos2 == np8::position());
+        Assert::IsTrue(pos2() == np8::position()());
+
+        np.unapply_move(pos2, 3, pos2);
+        np.unapply_move(pos2, 1, pos2);
+        Assert::IsTrue(pos2.zobrist == pos.zobrist);
+        Assert::IsTrue(pos2.zobrist != pos1.zobrist);
+    }
 
     TEST_METHOD(test_npuzzle2)
     {
@@ -241,6 +321,38 @@ public:
 
         Assert::AreEqual(51, (int)solution.size());
     }
+
+    TEST_METHOD(test_npuzzle_simd)
+    {
+        //  the linear conflicts of the SIMD kernels match the scalar ones
+        typedef npuzzle<4> npuzzle15;
+        npuzzle15 np;
+        std::vector<npuzzle15::position> positions(1, npuzzle15::position());
+        std::vector<npuzzle15::move> moves;
+        for (int i = 0; i < 1000; i++) {
+            moves.clear();
+            np.get_moves(positions.back(), moves);
+            npuzzle15::position pos;
+            np.apply_move(positions.back(), moves[(i*7 + i/3) % moves.size()], pos);
+            positions.push_back(pos);
+        }
+
+        const simd_level level = cpu_features::level();
+        cpu_features::set_level(simd_level::scalar);
+        std::vector<float> expected;
+        for (const auto& pos : positions) expected.push_back(np.estimate_cost(pos));
+        for (auto l : { simd_level::scalar, simd_level::ssse3, simd_level::avx2 }) {
+            cpu_features::set_level(l);
+            std::vector<float> estimates(positions.size());
+            np.estimate_costs(&positions[0], positions.size(), &estimates[0]);
+            for (size_t i = 0; i < positions.size(); i++) {
+                Assert::AreEqual(expected[i], estimates[i]);
+                Assert::AreEqual(expected[i], np.estimate_cost(positions[i]));
+            }
+        }
+        cpu_features::set_level(level);
+        Assert::IsTrue(cpu_features::level() <= cpu_features::supported());
+    }
 };
 
 
@@ -266,6 +378,252 @@ public:
         Assert::AreEqual(13, (int)solution.size());
 
     }
+
+    TEST_METHOD(test_moves_multiword)
+    {
+        //  10x10 board, larger than a single bitboard word
+        sliding_puzzle sp;
+        std::stringstream ss;
+        ss << "0.........\n..........\n..........\n...11.....\n...11.....\n"
+              "..........\n.....2222.\n..........\n..........\n..........\n";
+        sp.parse(ss);
+
+        std::vector<sliding_puzzle::move> moves;
+        sp.get_moves(sp.get_source(), moves);
+
+        int nmoves[3] = { 0, 0, 0 };
+        for (const auto& m : moves) nmoves[m.piece_id]++;
+
+        //  every free cell is reachable by the 1x1 piece
+        Assert::AreEqual(100 - 1 - 4 - 4, nmoves[0]);
+        //  2x2 piece: 9x9 offsets, minus the ones overlapping 0 and 2, minus the current one
+        Assert::AreEqual(81 - 1 - 2*5 - 1, nmoves[1]);
+        //  1x4 piece: 7x10 offsets, minus the ones overlapping 0 and 1, minus the current one
+        Assert::AreEqual(70 - 1 - 2*5 - 1, nmoves[2]);
+    }
+
+    TEST_METHOD(test_zobrist)
+    {
+        sliding_puzzle sp;
+        std::stringstream ss;
+        ss << "24600\n88611\n7..53\n\n..65.\n42600\n88311";
+        sp.parse(ss);
+
+        //  moving pieces back and forth restores the hash
+        const sliding_puzzle::position src = sp.get_source();
+        sliding_puzzle::position pos = src;
+        sp.apply_move(pos, { 7, 1, 0 }, pos);
+        sp.apply_move(pos, { 4, 1, 1 }, pos);
+        Assert::IsTrue(pos.zobrist != src.zobrist);
+        sp.apply_move(pos, { 7, 1, 0 }, pos);
+        sp.apply_move(pos, { 7, -2, 0 }, pos);
+        sp.unapply_move(pos, { 4, 1, 1 }, pos);
+        Assert::IsTrue(pos == src);
+        Assert::IsTrue(pos.zobrist == src.zobrist);
+
+        //  both position types hash the same way
+        typedef sliding_puzzle::fixed_position<16> fixed_pos;
+        fixed_pos fpos = sp.get_source<fixed_pos>();
+        Assert::IsTrue(fpos.zobrist == src.zobrist);
+    }
+
+    TEST_METHOD(test_klotski_interchangeable)
+    {
+        sliding_puzzle sp;
+        std::stringstream ss;
+        ss << "1223\n1223\n4556\n4786\n9..0\n\n....\n....\n....\n.22.\n.22.";
+        sp.parse(ss);
+
+        typedef sliding_puzzle::fixed_position<16> fixed_pos;
+        astar<sliding_puzzle, fixed_pos> solver(sp, sp.get_source<fixed_pos>());
+
+        solver.solve();
+
+        std::vector<sliding_puzzle::move> solution;
+        bool hasSolution = solver.get_solution(solution);
+
+        Assert::IsTrue(hasSolution);
+        Assert::AreEqual(81, (int)solution.size());
+        //  equivalent positions with the same shaped pieces swapped, 
+        //  as well as mirror images are not revisited
+        Assert::IsTrue(sp.is_symmetric());
+        Assert::IsTrue(solver.num_visited() < 15000);
+
+        //  the moves are valid for the individual pieces as laid out
+        sliding_puzzle::position pos = sp.get_layout();
+        std::vector<sliding_puzzle::move> moves;
+        for (const auto& m : solution) {
+            moves.clear();
+            sp.get_moves(pos, moves);
+            Assert::IsTrue(std::find(moves.begin(), moves.end(), m) != moves.end());
+            Assert::AreEqual(0, (int)m.dst_shift);
+            sp.apply_move(pos, m, pos);
+        }
+        Assert::IsTrue(sp.is_target(pos));
+    }
+
+    TEST_METHOD(test_mirror)
+    {
+        sliding_puzzle sp;
+        std::stringstream ss;
+        ss << "1223\n1223\n4556\n4786\n9..0\n\n....\n....\n....\n.22.\n.22.";
+        sp.parse(ss);
+        Assert::IsTrue(sp.is_symmetric());
+
+        //  the layout itself is symmetric, so move some piece first
+        sliding_puzzle::position pos = sp.get_source();
+        sliding_puzzle::position mpos = pos;
+        sp.mirror_position(mpos);
+        Assert::IsTrue(mpos == pos);
+
+        std::vector<sliding_puzzle::move> moves;
+        sp.get_moves(pos, moves);
+        sp.apply_move(pos, moves[0], pos);
+        mpos = pos;
+        sp.mirror_position(mpos);
+        Assert::IsFalse(mpos == pos);
+        Assert::IsTrue(mpos.zobrist != pos.zobrist);
+
+        //  the mirror image of the mirror image is the position itself
+        sp.mirror_position(mpos);
+        Assert::IsTrue(mpos == pos);
+
+        //  the goal is not symmetric here
+        sliding_puzzle sp1;
+        std::stringstream ss1;
+        ss1 << "11188\n22338\n04455\n00666\n..7..\n\n..088\n..008\n.....\n.....\n.....";
+        sp1.parse(ss1);
+        Assert::IsFalse(sp1.is_symmetric());
+    }
+
+    TEST_METHOD(test_heuristic)
+    {
+        sliding_puzzle sp;
+        std::stringstream ss;
+        ss << "24600\n88611\n7..53\n\n..65.\n42600\n88311";
+        sp.parse(ss);
+
+        //  weighted mode: half of the manhattan distance by default
+        const sliding_puzzle::position pos = sp.get_source();
+        Assert::AreEqual(0.5f*(2 + 2 + 0 + 1 + 1 + 1 + 2 + 2), sp.estimate_cost(pos));
+        sp.set_heuristic(sliding_puzzle::heuristic::weighted, 1.0f);
+        Assert::AreEqual(1.0f*(2 + 2 + 0 + 1 + 1 + 1 + 2 + 2), sp.estimate_cost(pos));
+
+        //  admissible mode: number of the misplaced target pieces
+        sp.set_heuristic(sliding_puzzle::heuristic::admissible);
+        Assert::AreEqual(7.0f, sp.estimate_cost(pos));
+
+        astar<sliding_puzzle> solver(sp, sp.get_source());
+        solver.solve();
+
+        std::vector<sliding_puzzle::move> solution;
+        Assert::IsTrue(solver.get_solution(solution));
+        Assert::AreEqual(13, (int)solution.size());
+    }
+
+    TEST_METHOD(test_pattern_db)
+    {
+        const char* layout = "0112\n0.33\n45..\n\n....\n...0\n...0";
+        sliding_puzzle sp;
+        std::stringstream ss(layout);
+        sp.parse(ss);
+        sp.set_heuristic(sliding_puzzle::heuristic::admissible);
+
+        //  with all the pieces in the pattern, the database has the exact distances
+        Assert::IsTrue(sp.add_pattern_db({ 1, 2, 3, 4, 5 }));
+        Assert::AreEqual(12.0f, sp.estimate_cost(sp.get_source()));
+
+        astar<sliding_puzzle> solver(sp, sp.get_source());
+        solver.solve();
+        std::vector<sliding_puzzle::move> solution;
+        Assert::IsTrue(solver.get_solution(solution));
+        Assert::AreEqual(12, (int)solution.size());
+        Assert::IsTrue(solver.num_visited() < 100);
+
+        //  the database gets saved to the cache directory and memory-mapped from there
+        const std::string path = pattern_db::file_name(".", sp.pattern_dbs()[0]->key());
+        sliding_puzzle sp1;
+        std::stringstream ss1(layout);
+        sp1.parse(ss1);
+        Assert::IsTrue(sp1.add_pattern_db({ 1, 2, 3, 4, 5 }, "."));
+        Assert::IsFalse(sp1.pattern_dbs()[0]->is_mapped());
+        {
+            sliding_puzzle sp2;
+            std::stringstream ss2(layout);
+            sp2.parse(ss2);
+            Assert::IsTrue(sp2.add_pattern_db({ 1, 2, 3, 4, 5 }, "."));
+            Assert::IsTrue(sp2.pattern_dbs()[0]->is_mapped());
+            Assert::AreEqual(12.0f, sp2.pattern_dbs()[0]->lookup(sp2.get_source()));
+        }
+        std::remove(path.c_str());
+
+        //  the pattern database size limit
+        Assert::IsFalse(sp1.add_pattern_db({ 1, 2, 3, 4, 5 }, "", 1000));
+    }
+
+    TEST_METHOD(test_yank_fixed_position)
+    {
+        sliding_puzzle sp;
+        std::stringstream ss;
+        ss << "24600\n88611\n7..53\n\n..65.\n42600\n88311";
+        sp.parse(ss);
+
+        typedef sliding_puzzle::fixed_position<16> fixed_pos;
+        astar<sliding_puzzle, fixed_pos> solver(sp, sp.get_source<fixed_pos>());
+
+        solver.solve();
+
+        std::vector<sliding_puzzle::move> solution;
+        bool hasSolution = solver.get_solution(solution);
+
+        Assert::IsTrue(hasSolution);
+        Assert::AreEqual(13, (int)solution.size());
+
+        //  replay the solution on the heap-allocated position
+        sliding_puzzle::position pos = sp.get_layout();
+        for (const auto& m : solution) sp.apply_move(pos, m, pos);
+        Assert::IsTrue(sp.is_target(pos));
+    }
+
+    TEST_METHOD(test_parse_limits)
+    {
+        //  36 pieces at most, '0'-'9' and 'A'-'Z'
+        const std::string layout = "0123456\n789ABCD\nEFGHIJK\nLMNOPQR\nSTUVWXY\nZ......\n";
+        sliding_puzzle sp;
+        std::stringstream ss(layout + "\n.....Z.\n");
+        std::string error;
+        Assert::IsTrue(sp.parse(ss, error));
+        Assert::AreEqual(36, sp.num_pieces());
+
+        sliding_puzzle sp1;
+        std::stringstream ss1(layout + "abcdefg\nh......\n");
+        Assert::IsFalse(sp1.parse(ss1, error));
+        Assert::IsFalse(error.empty());
+        //  the target part is checked as well
+        sliding_puzzle sp2;
+        std::stringstream ss2(layout + "\n.....a.\n");
+        Assert::IsFalse(sp2.parse(ss2, error));
+
+        //  31 columns, 127 rows and 1024 cells at most
+        const std::string row31(31, '.');
+        std::string wide = "0" + row31.substr(1) + "\n";
+        sliding_puzzle sp3;
+        std::stringstream ss3(wide);
+        Assert::IsTrue(sp3.parse(ss3, error));
+        sliding_puzzle sp4;
+        std::stringstream ss4(wide.substr(0, 31) + ".\n");
+        Assert::IsFalse(sp4.parse(ss4, error));
+        std::string tall = "0\n";
+        for (int i = 0; i < 127; i++) tall += ".\n";
+        sliding_puzzle sp5;
+        std::stringstream ss5(tall);
+        Assert::IsFalse(sp5.parse(ss5, error));
+        std::string large = "0" + row31.substr(1) + "\n";
+        for (int i = 1; i < 40; i++) large += row31 + "\n";
+        sliding_puzzle sp6;
+        std::stringstream ss6(large);
+        Assert::IsFalse(sp6.parse(ss6, error));
+    }
 };
 
 TEST_CLASS(test_pool_alloc)
@@ -361,10 +719,1352 @@ public:
         }
         Assert::AreEqual(0, elem::s_elems);
     }
+
+    TEST_METHOD(test_pool_alloc_reset)
+    {
+        pool_alloc<uint64_t> alloc(4, 2.0);
+        Assert::AreEqual(0, (int)alloc.capacity());
+        Assert::AreEqual(0, (int)alloc.bytes());
+
+        std::vector<uint64_t*> elems;
+        for (int i = 0; i < 10; i++) {
+            elems.push_back(alloc.allocate());
+            *elems.back() = i;
+        }
+        //  pages of 4, 8
+        Assert::AreEqual(10, (int)alloc.size());
+        Assert::AreEqual(12, (int)alloc.capacity());
+        Assert::IsTrue(alloc.bytes() >= 12*sizeof(uint64_t));
+        Assert::AreEqual(10.0/12, alloc.occupancy(), 1e-9);
+        for (int i = 0; i < 10; i++) {
+            Assert::AreEqual(i, (int)*elems[i]);
+        }
+        alloc.free(elems[3]);
+        Assert::AreEqual(9, (int)alloc.size());
+
+        const uint64_t bytes = alloc.bytes();
+        alloc.reset();
+        Assert::AreEqual(0, (int)alloc.size());
+        Assert::AreEqual(12, (int)alloc.capacity());
+        Assert::IsTrue(bytes == alloc.bytes());
+
+        //  the pages kept are reused in order, the freed element is forgotten
+        for (int i = 0; i < 10; i++) {
+            Assert::IsTrue(alloc.allocate() == elems[i]);
+        }
+        Assert::AreEqual(12, (int)alloc.capacity());
+        Assert::AreEqual(2, (int)alloc._pages.size());
+    }
 };
 
 int test_pool_alloc::elem::s_elems = 0;
 
+TEST_CLASS(test_open_list)
+{
+public:
+
+    struct node {
+        float   cost_from_src;
+        float   cost_to_dst;
+        bool    in_front;
+
+        float total_cost() const { return cost_from_src + cost_to_dst; }
+    };
+
+    TEST_METHOD(test_bucket_queue_order)
+    {
+        std::vector<node> nodes = {
+            { 3.0f, 2.0f, true }, { 1.0f, 1.5f, true }, { 0.0f, 2.5f, true },
+            { 2.0f, 0.5f, true }, { 0.5f, 0.0f, true }, { 4.0f, 4.0f, true } };
+
+        bucket_queue<node> q;
+        for (auto& n : nodes) q.push(&n);
+        Assert::AreEqual(6, (int)q.size());
+
+        //  ordered by f, ties broken towards the higher g
+        Assert::IsTrue(q.pop() == &nodes[4]);
+        Assert::IsTrue(q.pop() == &nodes[3]);
+        Assert::IsTrue(q.pop() == &nodes[1]);
+        Assert::IsTrue(q.pop() == &nodes[2]);
+        Assert::IsTrue(q.pop() == &nodes[0]);
+        Assert::IsTrue(q.pop() == &nodes[5]);
+        Assert::IsTrue(q.pop() == nullptr);
+        Assert::IsTrue(q.empty());
+    }
+
+    TEST_METHOD(test_bucket_queue_lazy_update)
+    {
+        std::vector<node> nodes = { { 5.0f, 1.0f, true }, { 3.0f, 1.0f, true }, { 2.0f, 5.0f, true } };
+
+        bucket_queue<node> q;
+        for (auto& n : nodes) q.push(&n);
+
+        //  decrease key of the first node, the old entry becomes stale
+        q.erase(&nodes[0]);
+        nodes[0].cost_from_src = 1.0f;
+        q.push(&nodes[0]);
+
+        //  the last node leaves the front without being popped
+        nodes[2].in_front = false;
+
+        Assert::IsTrue(q.pop() == &nodes[0]);
+        nodes[0].in_front = false;
+        Assert::IsTrue(q.pop() == &nodes[1]);
+        Assert::IsTrue(q.pop() == nullptr);
+    }
+
+    TEST_METHOD(test_set_queue_order)
+    {
+        std::vector<node> nodes = { { 3.0f, 2.0f, true }, { 1.0f, 1.5f, true }, { 0.0f, 2.6f, true } };
+
+        set_queue<node> q;
+        for (auto& n : nodes) q.push(&n);
+        q.erase(&nodes[1]);
+
+        Assert::IsTrue(q.pop() == &nodes[2]);
+        Assert::IsTrue(q.pop() == &nodes[0]);
+        Assert::IsTrue(q.pop() == nullptr);
+    }
+};
+
+TEST_CLASS(test_idastar)
+{
+public:
+
+    TEST_METHOD(test_idastar_gridmap)
+    {
+        gridmap f(7,
+            "....XX."
+            ".XX.XX."
+            "...X..X"
+            ".X.....");
+
+        f.target = { 6, 3 };
+        idastar<gridmap> solver(f, { 0, 0 });
+        solver.solve();
+
+        moves_vec solution;
+        Assert::IsTrue(solver.get_solution(solution));
+        Assert::AreEqual(9, (int)solution.size());
+
+        f.target = { 6, 0 };
+        idastar<gridmap> solver1(f, { 0, 0 });
+        solver1.solve();
+        Assert::IsFalse(solver1.get_solution(solution));
+    }
+
+    TEST_METHOD(test_idastar_npuzzle)
+    {
+        typedef npuzzle<3> np8;
+        const char* tests[] = { "123405786", "413726580", "160842753", "876543210" };
+        const int min_moves[] = { 2, 8, 18, 30 };
+        for (int i = 0; i < 4; i++) {
+            std::array<int8_t, 9> start;
+            for (int j = 0; j < 9; j++) start[j] = tests[i][j] - '0';
+
+            np8 np;
+            for (int tt_bits : { 0, 12 }) {
+                idastar<np8> solver(np, np8::position(&start[0]), tt_bits);
+                solver.solve();
+                std::vector<np8::move> solution;
+                Assert::IsTrue(solver.get_solution(solution));
+                Assert::AreEqual(min_moves[i], (int)solution.size());
+                Assert::AreEqual((float)min_moves[i], solver.bound());
+            }
+        }
+
+        typedef npuzzle<4> npuzzle15;
+        const int8_t start[] =
+        { 1,  2, 13,  4,
+          7, 14, 10, 15,
+          9,  0,  5, 11,
+          8,  6,  3, 12 };
+        npuzzle15 np;
+        idastar<npuzzle15> solver(np, npuzzle15::position(start), 20);
+        solver.solve();
+        std::vector<npuzzle15::move> solution;
+        Assert::IsTrue(solver.get_solution(solution));
+        Assert::AreEqual(45, (int)solution.size());
+    }
+
+    TEST_METHOD(test_idastar_sliding_puzzle)
+    {
+        sliding_puzzle sp;
+        std::stringstream ss;
+        ss << "24600\n88611\n7..53\n\n..65.\n42600\n88311";
+        sp.parse(ss);
+        sp.set_heuristic(sliding_puzzle::heuristic::admissible);
+
+        idastar<sliding_puzzle> solver(sp, sp.get_source(), 16);
+        solver.solve();
+
+        std::vector<sliding_puzzle::move> solution;
+        Assert::IsTrue(solver.get_solution(solution));
+        Assert::AreEqual(13, (int)solution.size());
+
+        //  the resolved moves replay on the layout
+        sliding_puzzle::position pos = sp.get_layout();
+        for (const auto& m : solution) {
+            std::vector<sliding_puzzle::move> moves;
+            sp.get_moves(pos, moves);
+            Assert::IsTrue(std::find(moves.begin(), moves.end(), m) != moves.end());
+            sp.apply_move(pos, m, pos);
+        }
+        Assert::IsTrue(sp.is_target(pos));
+    }
+};
+
+TEST_CLASS(test_hdastar)
+{
+public:
+
+    TEST_METHOD(test_hdastar_gridmap)
+    {
+        gridmap f(7,
+            "....XX."
+            ".XX.XX."
+            "...X..X"
+            ".X.....");
+
+        for (int num_threads : { 1, 2, 4 }) {
+            f.target = { 6, 3 };
+            hdastar<gridmap> solver(f, { 0, 0 }, num_threads);
+            solver.solve();
+
+            moves_vec solution;
+            Assert::IsTrue(solver.get_solution(solution));
+            Assert::AreEqual(9, (int)solution.size());
+
+            f.target = { 6, 0 };
+            hdastar<gridmap> solver1(f, { 0, 0 }, num_threads);
+            solver1.solve();
+            Assert::IsFalse(solver1.get_solution(solution));
+        }
+    }
+
+    TEST_METHOD(test_hdastar_npuzzle)
+    {
+        typedef npuzzle<3> np8;
+        const char* tests[] = { "123405786", "413726580", "160842753", "876543210" };
+        const int min_moves[] = { 2, 8, 18, 30 };
+        for (int i = 0; i < 4; i++) {
+            std::array<int8_t, 9> start;
+            for (int j = 0; j < 9; j++) start[j] = tests[i][j] - '0';
+
+            np8 np;
+            for (int num_threads : { 1, 3, 8 }) {
+                hdastar<np8> solver(np, np8::position(&start[0]), num_threads);
+                solver.solve();
+                std::vector<np8::move> solution;
+                Assert::IsTrue(solver.get_solution(solution));
+                Assert::AreEqual(min_moves[i], (int)solution.size());
+                if (num_threads == 1) Assert::AreEqual(0, (int)solver.num_sent());
+            }
+        }
+    }
+
+    TEST_METHOD(test_hdastar_termination)
+    {
+        //  the threads going idle and busy again while the batches are in flight
+        //  must not end the search early, with no or a worse solution
+        typedef npuzzle<3> np8;
+        std::array<int8_t, 9> start;
+        for (int j = 0; j < 9; j++) start[j] = "876543210"[j] - '0';
+        np8 np;
+        for (int i = 0; i < 20; i++) {
+            hdastar<np8> solver(np, np8::position(&start[0]), 8);
+            solver.solve();
+            std::vector<np8::move> solution;
+            Assert::IsTrue(solver.get_solution(solution));
+            Assert::AreEqual(30, (int)solution.size());
+        }
+    }
+
+    TEST_METHOD(test_hdastar_sliding_puzzle)
+    {
+        sliding_puzzle sp;
+        std::stringstream ss;
+        ss << "24600\n88611\n7..53\n\n..65.\n42600\n88311";
+        sp.parse(ss);
+        sp.set_heuristic(sliding_puzzle::heuristic::admissible);
+
+        hdastar<sliding_puzzle> solver(sp, sp.get_source(), 4);
+        solver.solve();
+
+        std::vector<sliding_puzzle::move> solution;
+        Assert::IsTrue(solver.get_solution(solution));
+        Assert::AreEqual(13, (int)solution.size());
+
+        //  the resolved moves replay on the layout
+        sliding_puzzle::position pos = sp.get_layout();
+        for (const auto& m : solution) {
+            std::vector<sliding_puzzle::move> moves;
+            sp.get_moves(pos, moves);
+            Assert::IsTrue(std::find(moves.begin(), moves.end(), m) != moves.end());
+            sp.apply_move(pos, m, pos);
+        }
+        Assert::IsTrue(sp.is_target(pos));
+    }
+};
+
+TEST_CLASS(test_bidirectional)
+{
+public:
+
+    TEST_METHOD(test_bidirectional_gridmap)
+    {
+        gridmap f(7,
+            "....XX."
+            ".XX.XX."
+            "...X..X"
+            ".X.....");
+
+        f.target = { 6, 3 };
+        bidirectional<gridmap> solver(f, { 0, 0 });
+        Assert::IsTrue(solver.is_bidirectional());
+        solver.solve();
+
+        moves_vec solution;
+        Assert::IsTrue(solver.get_solution(solution));
+        Assert::AreEqual(9, (int)solution.size());
+        gridmap::position pos = { 0, 0 };
+        for (const auto& m : solution) f.apply_move(pos, m, pos);
+        Assert::IsTrue(f.is_target(pos));
+
+        f.target = { 6, 0 };
+        bidirectional<gridmap> solver1(f, { 0, 0 });
+        solver1.solve();
+        Assert::IsFalse(solver1.get_solution(solution));
+
+        f.target = { 0, 0 };
+        bidirectional<gridmap> solver2(f, { 0, 0 });
+        solver2.solve();
+        Assert::IsTrue(solver2.get_solution(solution));
+        Assert::AreEqual(0, (int)solution.size());
+    }
+
+    TEST_METHOD(test_bidirectional_npuzzle)
+    {
+        typedef npuzzle<3> np8;
+        const char* tests[] = { "123405786", "413726580", "160842753", "876543210" };
+        const int min_moves[] = { 2, 8, 18, 30 };
+        for (int i = 0; i < 4; i++) {
+            std::array<int8_t, 9> start;
+            for (int j = 0; j < 9; j++) start[j] = tests[i][j] - '0';
+
+            np8 np;
+            bidirectional<np8> solver(np, np8::position(&start[0]));
+            solver.solve();
+            std::vector<np8::move> solution;
+            Assert::IsTrue(solver.get_solution(solution));
+            Assert::AreEqual(min_moves[i], (int)solution.size());
+
+            np8::position pos(&start[0]);
+            for (const auto& m : solution) np.apply_move(pos, m, pos);
+            Assert::IsTrue(np.is_target(pos));
+        }
+    }
+
+    TEST_METHOD(test_bidirectional_sliding_puzzle)
+    {
+        //  the target with all the pieces (7 added to the yank one)
+        sliding_puzzle sp;
+        std::stringstream ss;
+        ss << "24600\n88611\n7..53\n\n..657\n42600\n88311";
+        sp.parse(ss);
+        sp.set_heuristic(sliding_puzzle::heuristic::admissible);
+
+        astar<sliding_puzzle> solver0(sp, sp.get_source());
+        solver0.solve();
+        std::vector<sliding_puzzle::move> solution0;
+        Assert::IsTrue(solver0.get_solution(solution0));
+
+        bidirectional<sliding_puzzle> solver(sp, sp.get_source());
+        Assert::IsTrue(solver.is_bidirectional());
+        solver.solve();
+        std::vector<sliding_puzzle::move> solution;
+        Assert::IsTrue(solver.get_solution(solution));
+        Assert::AreEqual(solution0.size(), solution.size());
+
+        //  the resolved moves replay on the layout
+        sliding_puzzle::position pos = sp.get_layout();
+        for (const auto& m : solution) {
+            std::vector<sliding_puzzle::move> moves;
+            sp.get_moves(pos, moves);
+            Assert::IsTrue(std::find(moves.begin(), moves.end(), m) != moves.end());
+            sp.apply_move(pos, m, pos);
+        }
+        Assert::IsTrue(sp.is_target(pos));
+
+        //  partial target, falls back to astar
+        sliding_puzzle sp1;
+        std::stringstream ss1;
+        ss1 << "24600\n88611\n7..53\n\n..65.\n42600\n88311";
+        sp1.parse(ss1);
+        sp1.set_heuristic(sliding_puzzle::heuristic::admissible);
+        bidirectional<sliding_puzzle> solver1(sp1, sp1.get_source());
+        Assert::IsFalse(solver1.is_bidirectional());
+        solver1.solve();
+        Assert::IsTrue(solver1.get_solution(solution));
+        Assert::AreEqual(13, (int)solution.size());
+    }
+};
+
+TEST_CLASS(test_arastar)
+{
+public:
+
+    TEST_METHOD(test_arastar_gridmap)
+    {
+        gridmap f(7,
+            "....XX."
+            ".XX.XX."
+            "...X..X"
+            ".X.....");
+
+        f.target = { 6, 3 };
+        arastar<gridmap> solver(f, { 0, 0 });
+        solver.solve();
+
+        moves_vec solution;
+        Assert::IsTrue(solver.get_solution(solution));
+        Assert::AreEqual(9, (int)solution.size());
+        Assert::AreEqual(1.0f, solver.bound());
+
+        f.target = { 6, 0 };
+        arastar<gridmap> solver1(f, { 0, 0 });
+        solver1.solve();
+        Assert::IsFalse(solver1.get_solution(solution));
+    }
+
+    TEST_METHOD(test_arastar_npuzzle)
+    {
+        typedef npuzzle<4> npuzzle15;
+        const int8_t start[] =
+        { 1,  2, 13,  4,
+          7, 14, 10, 15,
+          9,  0,  5, 11,
+          8,  6,  3, 12 };
+        npuzzle15 np;
+        arastar<npuzzle15> solver(np, npuzzle15::position(start), 3.0f, 0.5f);
+
+        //  every solution is within the bound of the optimal one
+        float cost = std::numeric_limits<float>::max();
+        int improvements = 0;
+        while (solver.improve()) {
+            Assert::IsTrue(solver.has_solution());
+            Assert::IsTrue(solver.solution_cost() <= cost);
+            Assert::IsTrue(solver.solution_cost() <= 45.0f*solver.bound() + 1e-3f);
+            if (solver.solution_cost() < cost) improvements++;
+            cost = solver.solution_cost();
+        }
+        Assert::IsTrue(improvements > 1);
+        Assert::AreEqual(1.0f, solver.bound());
+
+        std::vector<npuzzle15::move> solution;
+        Assert::IsTrue(solver.get_solution(solution));
+        Assert::AreEqual(45, (int)solution.size());
+    }
+
+    TEST_METHOD(test_arastar_sliding_puzzle)
+    {
+        sliding_puzzle sp;
+        std::stringstream ss;
+        ss << "24600\n88611\n7..53\n\n..65.\n42600\n88311";
+        sp.parse(ss);
+        sp.set_heuristic(sliding_puzzle::heuristic::admissible);
+
+        arastar<sliding_puzzle> solver(sp, sp.get_source(), 5.0f, 1.0f);
+        solver.solve();
+
+        std::vector<sliding_puzzle::move> solution;
+        Assert::IsTrue(solver.get_solution(solution));
+        Assert::AreEqual(13, (int)solution.size());
+
+        //  the resolved moves replay on the layout
+        sliding_puzzle::position pos = sp.get_layout();
+        for (const auto& m : solution) {
+            std::vector<sliding_puzzle::move> moves;
+            sp.get_moves(pos, moves);
+            Assert::IsTrue(std::find(moves.begin(), moves.end(), m) != moves.end());
+            sp.apply_move(pos, m, pos);
+        }
+        Assert::IsTrue(sp.is_target(pos));
+    }
+};
+
+TEST_CLASS(test_state_space)
+{
+public:
+
+    TEST_METHOD(test_rank_unrank)
+    {
+        sliding_puzzle sp;
+        std::stringstream ss;
+        ss << "1223\n1223\n4556\n4786\n9..0\n\n....\n....\n....\n.22.\n.22.";
+        sp.parse(ss);
+        Assert::IsTrue(sp.num_ranks() > 0);
+
+        //  the positions on a pseudo-random walk get the ranks which restore them
+        typedef sliding_puzzle::fixed_position<16> fixed_pos;
+        fixed_pos pos = sp.get_source<fixed_pos>(), res;
+        std::vector<sliding_puzzle::move> moves;
+        uint32_t seed = 1;
+        for (int i = 0; i < 1000; i++) {
+            const uint64_t r = sp.rank(pos);
+            Assert::IsTrue(r < sp.num_ranks());
+            Assert::IsTrue(sp.unrank(r, res));
+            Assert::IsTrue(res == pos);
+            Assert::IsTrue(res.zobrist == pos.zobrist);
+
+            moves.clear();
+            sp.get_moves(pos, moves);
+            seed = seed*1103515245 + 12345;
+            sp.apply_move(pos, moves[(seed >> 16) % moves.size()], pos);
+        }
+    }
+
+    TEST_METHOD(test_state_space_klotski)
+    {
+        sliding_puzzle sp;
+        std::stringstream ss;
+        ss << "1223\n1223\n4556\n4786\n9..0\n\n....\n....\n....\n.22.\n.22.";
+        sp.parse(ss);
+
+        typedef sliding_puzzle::fixed_position<16> fixed_pos;
+        const fixed_pos source = sp.get_source<fixed_pos>();
+        state_space space;
+        Assert::IsTrue(space.enumerate(sp, source, 2));
+
+        //  the positions up to swapping the same shaped pieces and mirroring
+        Assert::AreEqual(13011, (int)space.num_states());
+        uint64_t total = 0;
+        for (auto n : space.histogram()) total += n;
+        Assert::AreEqual(space.num_states(), total);
+        Assert::AreEqual(124, space.depth());
+
+        const uint64_t idx = space.index(sp.rank(source));
+        Assert::IsTrue(idx < space.num_states());
+        Assert::AreEqual(81, (int)space.distance_to_target(idx));
+
+        //  the distances to the target change by one move at most
+        fixed_pos pos = source, succ;
+        std::vector<sliding_puzzle::move> moves;
+        for (int i = 0; i < 200; i++) {
+            const int d = space.distance_to_target(space.index(sp.rank(pos)));
+            Assert::AreEqual(d == 0, sp.is_target(pos));
+            moves.clear();
+            sp.get_moves(pos, moves);
+            for (const auto& m : moves) {
+                sp.apply_move(pos, m, succ);
+                const int ds = space.distance_to_target(space.index(sp.rank(succ)));
+                Assert::IsTrue(ds >= d - 1 && ds <= d + 1);
+            }
+            sp.apply_move(pos, moves[i % moves.size()], pos);
+        }
+
+        //  saved and loaded
+        const std::string path = "klotski.spss";
+        Assert::IsTrue(space.save(path));
+        state_space loaded;
+        Assert::IsTrue(loaded.load(path, sp));
+        Assert::AreEqual(space.num_states(), loaded.num_states());
+        Assert::AreEqual(idx, loaded.index(sp.rank(source)));
+        Assert::AreEqual(81, (int)loaded.distance_to_target(idx));
+
+        //  not for another target on the same board
+        sliding_puzzle other;
+        std::stringstream ss1;
+        ss1 << "1223\n1223\n4556\n4786\n9..0\n\n.22.\n.22.\n....\n....\n....";
+        other.parse(ss1);
+        Assert::AreEqual(sp.num_ranks(), other.num_ranks());
+        state_space other_loaded;
+        Assert::IsFalse(other_loaded.load(path, other));
+        Assert::AreEqual(0, (int)other_loaded.num_states());
+        std::remove(path.c_str());
+
+        //  the empty one
+        state_space empty;
+        Assert::IsTrue(empty.save(path));
+        Assert::IsFalse(loaded.load(path, sp));
+        Assert::AreEqual(space.num_states(), loaded.num_states());
+        std::remove(path.c_str());
+    }
+};
+
+TEST_CLASS(test_external_search)
+{
+public:
+
+    TEST_METHOD(test_external_search_gridmap)
+    {
+        gridmap f(7,
+            "....XX."
+            ".XX.XX."
+            "...X..X"
+            ".X.....");
+
+        f.target = { 6, 3 };
+        external_search<gridmap> solver(f, { 0, 0 }, ".");
+        solver.solve();
+
+        moves_vec solution;
+        Assert::IsFalse(solver.failed());
+        Assert::IsTrue(solver.get_solution(solution));
+        Assert::AreEqual(9, (int)solution.size());
+        Assert::AreEqual(9, solver.depth());
+
+        f.target = { 6, 0 };
+        external_search<gridmap> solver1(f, { 0, 0 }, ".");
+        solver1.solve();
+        Assert::IsFalse(solver1.get_solution(solution));
+    }
+
+    TEST_METHOD(test_external_search_sliding_puzzle)
+    {
+        sliding_puzzle sp;
+        std::stringstream ss;
+        ss << "1223\n1223\n4556\n4786\n9..0\n\n....\n....\n....\n.22.\n.22.";
+        sp.parse(ss);
+
+        //  the memory limit of a few hundred positions, many runs per layer
+        typedef sliding_puzzle::fixed_position<16> fixed_pos;
+        external_search<sliding_puzzle, fixed_pos> solver(sp, sp.get_source<fixed_pos>(), ".", 
+            256*sizeof(fixed_pos));
+        solver.solve();
+
+        std::vector<sliding_puzzle::move> solution;
+        Assert::IsFalse(solver.failed());
+        Assert::IsTrue(solver.get_solution(solution));
+        Assert::AreEqual(81, (int)solution.size());
+        Assert::IsTrue(solver.num_runs() > (uint64_t)solver.depth());
+        //  the layers don't overlap: no more positions than in the whole state space
+        Assert::IsTrue(solver.num_visited() <= 13011);
+
+        //  the resolved moves replay on the layout
+        sliding_puzzle::position pos = sp.get_layout();
+        for (const auto& m : solution) {
+            std::vector<sliding_puzzle::move> moves;
+            sp.get_moves(pos, moves);
+            Assert::IsTrue(std::find(moves.begin(), moves.end(), m) != moves.end());
+            sp.apply_move(pos, m, pos);
+        }
+        Assert::IsTrue(sp.is_target(pos));
+    }
+};
+
+TEST_CLASS(test_astar_budget)
+{
+public:
+
+    TEST_METHOD(test_astar_budget_resume)
+    {
+        typedef npuzzle<4> npuzzle15;
+        const int8_t start[] =
+        { 1,  2, 13,  4,
+          7, 14, 10, 15,
+          9,  0,  5, 11,
+          8,  6,  3, 12 };
+        npuzzle15 np;
+        astar<npuzzle15> full(np, npuzzle15::position(start));
+        full.solve();
+        std::vector<npuzzle15::move> expected, solution;
+        Assert::IsTrue(full.get_solution(expected));
+
+        //  the search continued by the budgeted calls gets the same solution
+        astar<npuzzle15> solver(np, npuzzle15::position(start));
+        search_limits limits;
+        limits.max_expansions = 1000;
+        int ncalls = 0;
+        search_status status;
+        while ((status = solver.solve(limits)) == search_status::expansion_limit) {
+            Assert::AreEqual((uint64_t)1000*++ncalls, solver.num_expanded());
+        }
+        Assert::IsTrue(status == search_status::solved);
+        Assert::IsTrue(ncalls > 1);
+        Assert::IsTrue(solver.get_solution(solution));
+        Assert::AreEqual((int)expected.size(), (int)solution.size());
+
+        limits.max_expansions = 0;
+        limits.max_bytes = 1;
+        astar<npuzzle15> solver1(np, npuzzle15::position(start));
+        Assert::IsTrue(solver1.solve(limits) == search_status::memory_limit);
+    }
+
+    TEST_METHOD(test_astar_checkpoint)
+    {
+        sliding_puzzle sp;
+        std::stringstream ss;
+        ss << "1223\n1223\n4556\n4786\n9..0\n\n....\n....\n....\n.22.\n.22.";
+        sp.parse(ss);
+
+        typedef sliding_puzzle::fixed_position<16> fixed_pos;
+        search_limits limits;
+        limits.max_expansions = 3000;
+        const std::string path = "klotski.ckpt";
+        {
+            astar<sliding_puzzle, fixed_pos> solver(sp, sp.get_source<fixed_pos>());
+            Assert::IsTrue(solver.solve(limits) == search_status::expansion_limit);
+            Assert::IsTrue(solver.save(path));
+        }
+
+        //  resumed by another search
+        astar<sliding_puzzle, fixed_pos> solver(sp, sp.get_source<fixed_pos>());
+        Assert::IsTrue(solver.load(path));
+        Assert::AreEqual((uint64_t)3000, solver.num_expanded());
+        limits.max_expansions = 0;
+        Assert::IsTrue(solver.solve(limits) == search_status::solved);
+        std::vector<sliding_puzzle::move> solution;
+        Assert::IsTrue(solver.get_solution(solution));
+        Assert::AreEqual(81, (int)solution.size());
+        Assert::IsTrue(solver.save(path));
+
+        //  the checkpoints of the other boards and the other sources are rejected
+        sliding_puzzle other;
+        std::stringstream ss1("24600\n88611\n7..53\n\n..65.\n42600\n88311");
+        other.parse(ss1);
+        astar<sliding_puzzle, fixed_pos> other_solver(other, other.get_source<fixed_pos>());
+        Assert::IsFalse(other_solver.load(path));
+        Assert::IsTrue(other_solver.solve(limits) == search_status::solved);
+        Assert::IsTrue(other_solver.get_solution(solution));
+
+        fixed_pos source = sp.get_source<fixed_pos>();
+        std::vector<sliding_puzzle::move> moves;
+        sp.get_moves(source, moves);
+        sp.apply_move(source, moves[0], source);
+        astar<sliding_puzzle, fixed_pos> moved_solver(sp, source);
+        Assert::IsFalse(moved_solver.load(path));
+        Assert::AreEqual((uint64_t)0, moved_solver.num_expanded());
+
+        //  and the ones of the other heuristics, the nodes keeping their estimates
+        sliding_puzzle admissible;
+        std::stringstream ss2;
+        ss2 << "1223\n1223\n4556\n4786\n9..0\n\n....\n....\n....\n.22.\n.22.";
+        admissible.parse(ss2);
+        Assert::AreEqual(sp.board_key(), admissible.board_key());
+        admissible.set_heuristic(sliding_puzzle::heuristic::admissible);
+        Assert::IsTrue(sp.heuristic_key() != admissible.heuristic_key());
+        astar<sliding_puzzle, fixed_pos> admissible_solver(admissible, admissible.get_source<fixed_pos>());
+        Assert::IsFalse(admissible_solver.load(path));
+        admissible.set_heuristic(sliding_puzzle::heuristic::weighted, 3.0f);
+        Assert::IsTrue(sp.heuristic_key() != admissible.heuristic_key());
+        Assert::IsFalse(admissible_solver.load(path));
+        admissible.set_heuristic(sliding_puzzle::heuristic::weighted);
+        Assert::IsTrue(admissible_solver.load(path));
+        std::remove(path.c_str());
+
+        //  the positions which can't be saved as they are
+        astar<sliding_puzzle> solver1(sp, sp.get_source());
+        Assert::IsFalse(solver1.save(path));
+        Assert::IsFalse(solver1.load("no such file"));
+    }
+};
+
+TEST_CLASS(test_search_observer)
+{
+public:
+
+    TEST_METHOD(test_stats_observer)
+    {
+        typedef npuzzle<4> npuzzle15;
+        const int8_t start[] =
+        { 1,  2, 13,  4,
+          7, 14, 10, 15,
+          9,  0,  5, 11,
+          8,  6,  3, 12 };
+        npuzzle15 np;
+        astar<npuzzle15, npuzzle15::position, npuzzle15::move, bucket_queue_policy<>, 
+            stats_observer<true>> solver(np, npuzzle15::position(start));
+        uint64_t nreports = 0;
+        solver.observer().set_progress(1000, [&](const search_stats& stats) {
+            Assert::AreEqual(++nreports*1000, stats.expanded);
+        });
+        solver.solve();
+
+        std::vector<npuzzle15::move> solution;
+        Assert::IsTrue(solver.get_solution(solution));
+        const search_stats& stats = solver.observer().stats();
+        Assert::AreEqual(solver.num_expanded(), stats.expanded);
+        Assert::AreEqual(stats.expanded/1000, nreports);
+        //  every successor is either a new node or a visited one
+        Assert::AreEqual(stats.generated, stats.duplicates + solver.num_visited() - 1);
+        Assert::AreEqual(solver.num_visited(), stats.visited);
+        Assert::IsTrue(stats.max_f <= (float)solution.size());
+        for (size_t i = 1; i < stats.f_progression.size(); i++) {
+            Assert::IsTrue(stats.f_progression[i - 1].first < stats.f_progression[i].first);
+            Assert::IsTrue(stats.f_progression[i - 1].second < stats.f_progression[i].second);
+        }
+        Assert::IsTrue(stats.phase_seconds[(int)search_phase::moves] > 0.0);
+    }
+};
+
+TEST_CLASS(test_thread_pool)
+{
+public:
+
+    TEST_METHOD(test_tasks)
+    {
+        thread_pool pool(4);
+        Assert::AreEqual(4, pool.num_threads());
+        std::atomic<int> count(0);
+        std::atomic<int64_t> sum(0);
+        for (int i = 0; i < 1000; i++) {
+            pool.submit([&, i] {
+                count++;
+                sum += i;
+            });
+        }
+        pool.wait();
+        Assert::AreEqual(1000, count.load());
+        Assert::AreEqual((int64_t)999*1000/2, sum.load());
+
+        //  the pool is reusable after wait()
+        for (int i = 0; i < 10; i++) pool.submit([&] { count++; });
+        pool.wait();
+        Assert::AreEqual(1010, count.load());
+    }
+
+    TEST_METHOD(test_nested_tasks)
+    {
+        //  the tasks submitted by a task are waited for as well
+        std::atomic<int> count(0);
+        {
+            thread_pool pool(3);
+            for (int i = 0; i < 10; i++) {
+                pool.submit([&] {
+                    for (int j = 0; j < 10; j++) {
+                        pool.submit([&] {
+                            std::this_thread::sleep_for(std::chrono::microseconds(100));
+                            count++;
+                        });
+                    }
+                    count++;
+                });
+            }
+            pool.wait();
+            Assert::AreEqual(110, count.load());
+            pool.submit([&] { count++; });
+        }
+        //  the destructor runs the tasks left
+        Assert::AreEqual(111, count.load());
+    }
+};
+
+TEST_CLASS(test_solve_service)
+{
+public:
+
+    TEST_METHOD(test_cached_solutions)
+    {
+        const std::string klotski = "1223\n1223\n4556\n4786\n9..0\n\n....\n....\n....\n.22.\n.22.";
+        solve_service service;
+        solve_options opt;
+        opt.heuristic = "admissible";
+
+        //  the concurrent requests for the same board share the search
+        std::vector<solve_result> results(8);
+        {
+            thread_pool pool(4);
+            for (size_t i = 0; i < results.size(); i++) {
+                pool.submit([&, i] { results[i] = service.solve(klotski, opt); });
+            }
+        }
+        int ncached = 0;
+        for (const auto& res : results) {
+            Assert::AreEqual(std::string("solved"), res.status);
+            Assert::AreEqual((size_t)81, res.moves.size());
+            if (res.cached) ncached++;
+        }
+        Assert::AreEqual(7, ncached);
+        solve_service::stats stats = service.get_stats();
+        Assert::AreEqual((uint64_t)8, stats.requests);
+        Assert::AreEqual((uint64_t)7, stats.board_hits);
+        Assert::AreEqual((uint64_t)7, stats.solution_hits);
+        Assert::AreEqual((size_t)1, stats.boards);
+
+        //  the carriage returns don't make another board, the heuristic does
+        std::string crlf;
+        for (char c : klotski) crlf += (c == '\n') ? std::string("\r\n") : std::string(1, c);
+        Assert::IsTrue(service.solve(crlf, opt).cached);
+        Assert::IsTrue(service.board(crlf, opt) == service.board(klotski, opt));
+        opt.heuristic = "weighted";
+        Assert::IsFalse(service.solve(klotski, opt).cached);
+        Assert::AreEqual((size_t)2, service.get_stats().boards);
+
+        //  the searches stopped by the limits are not cached
+        opt.heuristic = "admissible";
+        const std::string ma = "11188\n22338\n04455\n00666\n..7..\n\n..088\n..008\n.....\n.....\n.....";
+        opt.time_limit = 1e-9;
+        Assert::AreEqual(std::string("time_limit"), service.solve(ma, opt).status);
+        opt.time_limit = 0.0;
+        const solve_result res = service.solve(ma, opt);
+        Assert::IsFalse(res.cached);
+        Assert::AreEqual(std::string("solved"), res.status);
+    }
+
+    TEST_METHOD(test_layouts_of_board)
+    {
+        //  the other layouts of a board share its precomputation, not the solution
+        const std::string klotski = "1223\n1223\n4556\n4786\n9..0\n\n....\n....\n....\n.22.\n.22.";
+        const std::string moved = "1223\n1223\n4556\n4786\n.9.0\n\n....\n....\n....\n.22.\n.22.";
+        const std::string swapped = "1223\n1223\n4556\n4786\n0..9\n\n....\n....\n....\n.22.\n.22.";
+        const std::string mirrored = "3221\n3221\n6554\n6874\n0..9\n\n....\n....\n....\n.22.\n.22.";
+        solve_service service;
+        solve_options opt;
+        opt.heuristic = "admissible";
+        const solve_result res = service.solve(klotski, opt);
+        Assert::AreEqual((size_t)81, res.moves.size());
+        auto board = service.board(klotski, opt);
+        Assert::IsTrue(service.board(moved, opt) == board);
+
+        for (const auto& text : { moved, swapped, mirrored }) {
+            const solve_result res1 = service.solve(text, opt);
+            Assert::IsFalse(res1.cached);
+            Assert::AreEqual(std::string("solved"), res1.status);
+
+            //  the moves are of the pieces as in the requested layout
+            sliding_puzzle sp;
+            std::stringstream ss(text);
+            sp.parse(ss);
+            sp.set_heuristic(sliding_puzzle::heuristic::admissible);
+            astar<sliding_puzzle> solver(sp, sp.get_source());
+            solver.solve();
+            std::vector<sliding_puzzle::move> expected;
+            Assert::IsTrue(solver.get_solution(expected));
+            Assert::AreEqual(expected.size(), res1.moves.size());
+            sliding_puzzle::position pos = sp.get_layout();
+            for (const auto& m : res1.moves) {
+                std::vector<sliding_puzzle::move> moves;
+                sp.get_moves(pos, moves);
+                Assert::IsTrue(std::find(moves.begin(), moves.end(), m) != moves.end());
+                sp.apply_move(pos, m, pos);
+            }
+            Assert::IsTrue(sp.is_target(pos));
+            Assert::IsTrue(service.solve(text, opt).cached);
+        }
+        solve_service::stats stats = service.get_stats();
+        Assert::AreEqual((size_t)1, stats.boards);
+        Assert::AreEqual((uint64_t)9, stats.requests);
+        Assert::AreEqual((uint64_t)8, stats.board_hits);
+        Assert::AreEqual(81, (int)service.solve(klotski, opt).moves.size());
+    }
+
+    TEST_METHOD(test_invalid_and_evicted)
+    {
+        solve_service service(1);
+        solve_options opt;
+        Assert::AreEqual(std::string("error"), service.solve("0a\n", opt).status);
+        Assert::AreEqual(std::string("error"), service.solve("..\n..\n", opt).status);
+        Assert::IsTrue(service.board("0a\n", opt) == nullptr);
+        Assert::AreEqual((size_t)0, service.get_stats().boards);
+        Assert::AreEqual(std::string("no pieces"), service.solve("..\n..\n", opt).error);
+        //  the boards over the size limits
+        const solve_result wide = service.solve(std::string(32, '.') + "0\n", opt);
+        Assert::AreEqual(std::string("error"), wide.status);
+        Assert::IsFalse(wide.error.empty());
+        Assert::AreEqual((size_t)0, service.get_stats().boards);
+
+        //  the least recently used board is dropped
+        auto board0 = service.board("0.\n\n.0\n", opt);
+        Assert::IsTrue(board0 != nullptr);
+        Assert::IsTrue(service.board("0.\n\n.0\n", opt) == board0);
+        service.board("00.\n\n.00\n", opt);
+        Assert::AreEqual((size_t)1, service.get_stats().boards);
+        Assert::IsTrue(service.board("0.\n\n.0\n", opt) != board0);
+    }
+};
+
+TEST_CLASS(test_solution_cache)
+{
+public:
+
+    TEST_METHOD(test_store)
+    {
+        const std::string path = "test.spsc";
+        {
+            solution_cache cache(42);
+            cache.add(7, 3);
+            cache.add(5, 10);
+            cache.add(5, 12);
+            uint16_t dist = 0;
+            Assert::IsTrue(cache.lookup(5, dist));
+            Assert::AreEqual(10, (int)dist);
+            Assert::IsFalse(cache.lookup(6, dist));
+            Assert::IsTrue(cache.save(path));
+        }
+
+        solution_cache cache(42);
+        Assert::IsTrue(cache.load(path));
+        Assert::IsTrue(cache.is_mapped());
+        Assert::AreEqual((size_t)2, cache.size());
+        uint16_t dist = 0;
+        Assert::IsTrue(cache.lookup(7, dist));
+        Assert::AreEqual(3, (int)dist);
+
+        //  the shorter distances replace the stored ones on saving
+        cache.add(5, 4);
+        cache.add(1, 1);
+        Assert::IsTrue(cache.lookup(5, dist));
+        Assert::AreEqual(4, (int)dist);
+        Assert::IsTrue(cache.save(path));
+        Assert::IsTrue(cache.load(path));
+        Assert::AreEqual((size_t)3, cache.size());
+        Assert::IsTrue(cache.lookup(5, dist));
+        Assert::AreEqual(4, (int)dist);
+        Assert::IsTrue(cache.lookup(1, dist));
+
+        //  the other boards' files are not loaded
+        solution_cache other(43);
+        Assert::IsFalse(other.load(path));
+        std::remove(path.c_str());
+    }
+
+    TEST_METHOD(test_known_solutions)
+    {
+        const char* klotski = "1223\n1223\n4556\n4786\n9..0\n\n....\n....\n....\n.22.\n.22.";
+        //  another layout of the same board, a move away
+        const char* klotski1 = "1223\n1223\n4556\n4786\n9.0.\n\n....\n....\n....\n.22.\n.22.";
+        typedef sliding_puzzle::fixed_position<16> fixed_pos;
+        auto solve = [](sliding_puzzle& sp, std::vector<sliding_puzzle::move>& solution) {
+            astar<sliding_puzzle, fixed_pos> solver(sp, sp.get_source<fixed_pos>());
+            solver.solve();
+            Assert::IsTrue(solver.get_solution(solution));
+            //  the moves are valid for the individual pieces as laid out
+            sliding_puzzle::position pos = sp.get_layout();
+            std::vector<sliding_puzzle::move> moves;
+            for (const auto& m : solution) {
+                moves.clear();
+                sp.get_moves(pos, moves);
+                Assert::IsTrue(std::find(moves.begin(), moves.end(), m) != moves.end());
+                sp.apply_move(pos, m, pos);
+            }
+            Assert::IsTrue(sp.is_target(pos));
+            return solver.num_visited();
+        };
+
+        sliding_puzzle sp, sp1;
+        std::stringstream ss(klotski), ss1(klotski1);
+        sp.parse(ss);
+        sp1.parse(ss1);
+        sp.set_heuristic(sliding_puzzle::heuristic::admissible);
+        sp1.set_heuristic(sliding_puzzle::heuristic::admissible);
+        Assert::AreEqual(sp.board_key(), sp1.board_key());
+
+        std::vector<sliding_puzzle::move> solution, solution1;
+        const uint32_t visited1 = solve(sp1, solution1);
+
+        auto cache = std::make_shared<solution_cache>(sp.board_key());
+        solve(sp, solution);
+        Assert::AreEqual((size_t)81, solution.size());
+        sp.record_solution(*cache, solution);
+        Assert::AreEqual((size_t)82, cache->size());
+
+        //  the solved position is done right away
+        sp.set_solution_cache(cache);
+        Assert::AreEqual(1u, solve(sp, solution));
+        Assert::AreEqual((size_t)81, solution.size());
+
+        //  the other layout stops at the solved path, with the same optimal length
+        sp1.set_solution_cache(cache);
+        std::vector<sliding_puzzle::move> cached1;
+        Assert::IsTrue(solve(sp1, cached1) < visited1);
+        Assert::AreEqual(solution1.size(), cached1.size());
+
+        //  the checkpoint of the search keeps the rest of the path, the cache not needed to resume it
+        const std::string path = "klotski_known.ckpt";
+        {
+            astar<sliding_puzzle, fixed_pos> solver(sp1, sp1.get_source<fixed_pos>());
+            solver.solve();
+            Assert::IsTrue(solver.save(path));
+        }
+        sliding_puzzle sp2;
+        std::stringstream ss2(klotski1);
+        sp2.parse(ss2);
+        sp2.set_heuristic(sliding_puzzle::heuristic::admissible);
+        astar<sliding_puzzle, fixed_pos> loaded(sp2, sp2.get_source<fixed_pos>());
+        Assert::IsTrue(loaded.load(path));
+        std::vector<sliding_puzzle::move> resumed;
+        Assert::IsTrue(loaded.get_solution(resumed));
+        Assert::IsTrue(resumed == cached1);
+        std::remove(path.c_str());
+    }
+};
+
+TEST_CLASS(test_astar_nodes)
+{
+public:
+
+    TEST_METHOD(test_packed_positions)
+    {
+        //  the offsets fit 64 bits, and the 26 pieces don't (but the ranks do)
+        const char* puzzles[] = {
+            "1223\n1223\n4556\n4786\n9..0\n\n....\n....\n....\n.22.\n.22.",
+            "0123ABCD\n4567EFGH\n89IJKL..\nMNOPQR..\n\n........\n........\n........\n.......0" };
+        typedef sliding_puzzle::fixed_position<32> fixed_pos;
+        for (const char* puzzle : puzzles) {
+            sliding_puzzle sp;
+            std::stringstream ss(puzzle);
+            sp.parse(ss);
+            Assert::IsTrue(sp.num_ranks() != 0);
+
+            fixed_pos pos = sp.get_source<fixed_pos>(), unpacked;
+            sliding_puzzle::position dpos = sp.get_source(), dunpacked;
+            std::vector<sliding_puzzle::move> moves;
+            for (int i = 0; i < 500; i++) {
+                uint64_t packed, dpacked;
+                Assert::IsTrue(sp.pack_position(pos, packed));
+                sp.unpack_position(packed, unpacked);
+                Assert::IsTrue(unpacked == pos);
+                Assert::IsTrue(sp.pack_position(dpos, dpacked));
+                Assert::AreEqual(packed, dpacked);
+                sp.unpack_position(dpacked, dunpacked);
+                Assert::IsTrue(dunpacked == dpos);
+
+                moves.clear();
+                sp.get_moves(pos, moves);
+                const auto& m = moves[(i*7) % moves.size()];
+                sp.apply_move(pos, m, pos);
+                sp.apply_move(dpos, m, dpos);
+            }
+        }
+    }
+
+    TEST_METHOD(test_node_bytes)
+    {
+        //  a node takes less than a half of the position, the move and the float costs
+        sliding_puzzle sp;
+        std::stringstream ss("1223\n1223\n4556\n4786\n9..0\n\n....\n....\n....\n.22.\n.22.");
+        sp.parse(ss);
+        typedef sliding_puzzle::fixed_position<16> fixed_pos;
+        astar<sliding_puzzle, fixed_pos> solver(sp, sp.get_source<fixed_pos>());
+        Assert::IsTrue(solver.packed_positions());
+        Assert::IsTrue(2*solver.node_bytes() <= sizeof(fixed_pos) + sizeof(sliding_puzzle::move) + 2*sizeof(float));
+        solver.solve();
+        std::vector<sliding_puzzle::move> solution;
+        Assert::IsTrue(solver.get_solution(solution));
+        Assert::AreEqual(81, (int)solution.size());
+
+        typedef npuzzle<4> npuzzle15;
+        npuzzle15 np;
+        astar<npuzzle15> np_solver(np, npuzzle15::position());
+        Assert::IsTrue(np_solver.packed_positions());
+        Assert::IsTrue(2*np_solver.node_bytes() <= sizeof(npuzzle15::position) + sizeof(npuzzle15::move) + 2*sizeof(float));
+
+        //  the positions kept as they are, with the float costs
+        gridmap f(3, "..." ".X." "...");
+        f.target = { 2, 2 };
+        astar<gridmap> grid_solver(f, { 0, 0 });
+        Assert::IsFalse(grid_solver.packed_positions());
+        grid_solver.solve();
+        std::vector<gridmap::move> path;
+        Assert::IsTrue(grid_solver.get_solution(path));
+        Assert::AreEqual(4, (int)path.size());
+    }
+
+    //  counts the cost estimations
+    struct counting_puzzle : public sliding_puzzle {
+        mutable uint64_t estimates = 0;
+
+        template <typename TPos>
+        float estimate_cost(const TPos& pos) const {
+            estimates++;
+            return sliding_puzzle::estimate_cost(pos);
+        }
+    };
+
+    TEST_METHOD(test_estimate_once)
+    {
+        //  the positions reached by the better paths are not estimated again
+        counting_puzzle sp;
+        std::stringstream ss("24600\n88611\n7..53\n\n..65.\n42600\n88311");
+        sp.parse(ss);
+        typedef sliding_puzzle::fixed_position<16> fixed_pos;
+        astar<counting_puzzle, fixed_pos, sliding_puzzle::move, bucket_queue_policy<>, stats_observer<>> 
+            solver(sp, sp.get_source<fixed_pos>());
+        solver.solve();
+        const search_stats& stats = solver.observer().stats();
+        Assert::IsTrue(stats.updated + stats.reopened > 0);
+        Assert::AreEqual(stats.generated - stats.duplicates, sp.estimates);
+        Assert::AreEqual((uint64_t)stats.visited, sp.estimates + 1);
+    }
+};
+
+TEST_CLASS(test_astar_batch)
+{
+public:
+
+    TEST_METHOD(test_astar_batch_npuzzle)
+    {
+        typedef npuzzle<4> npuzzle15;
+        const int8_t start[] =
+        { 6, 14, 3,  13,
+          7,  1, 0,   5,
+          8, 10, 2,  12,
+         15,  9, 11,  4};
+        npuzzle15 np;
+        for (uint32_t batch : { 1, 4, 16, 64 }) {
+            astar<npuzzle15, npuzzle15::position, npuzzle15::move, bucket_queue_policy<>, 
+                stats_observer<>> solver(np, npuzzle15::position(start));
+            solver.set_batch_size(batch);
+            solver.solve();
+            std::vector<npuzzle15::move> solution;
+            Assert::IsTrue(solver.get_solution(solution));
+            Assert::AreEqual(51, (int)solution.size());
+
+            //  every successor is either a new node or a visited one, also within a batch
+            const search_stats& stats = solver.observer().stats();
+            Assert::AreEqual(solver.num_expanded(), stats.expanded);
+            Assert::AreEqual(stats.generated, stats.duplicates + solver.num_visited() - 1);
+        }
+    }
+
+    TEST_METHOD(test_astar_batch_budget)
+    {
+        //  the batches are cut to the expansion budget
+        typedef npuzzle<4> npuzzle15;
+        const int8_t start[] =
+        { 1,  2, 13,  4,
+          7, 14, 10, 15,
+          9,  0,  5, 11,
+          8,  6,  3, 12 };
+        npuzzle15 np;
+        astar<npuzzle15> solver(np, npuzzle15::position(start));
+        solver.set_batch_size(10);
+        search_limits limits;
+        limits.max_expansions = 1005;
+        Assert::IsTrue(search_status::expansion_limit == solver.solve(limits));
+        Assert::AreEqual(1005, (int)solver.num_expanded());
+        Assert::IsTrue(search_status::solved == solver.solve(search_limits()));
+        std::vector<npuzzle15::move> solution;
+        Assert::IsTrue(solver.get_solution(solution));
+        Assert::AreEqual(45, (int)solution.size());
+    }
+
+    TEST_METHOD(test_astar_batch_sliding_puzzle)
+    {
+        //  the problems without estimate_costs() are estimated one by one
+        sliding_puzzle sp;
+        std::stringstream ss("1223\n1223\n4556\n4786\n9..0\n\n....\n....\n....\n.22.\n.22.");
+        sp.parse(ss);
+        sp.set_heuristic(sliding_puzzle::heuristic::admissible);
+        typedef sliding_puzzle::fixed_position<16> fixed_pos;
+        for (uint32_t batch : { 1, 8 }) {
+            astar<sliding_puzzle, fixed_pos> solver(sp, sp.get_source<fixed_pos>());
+            solver.set_batch_size(batch);
+            solver.solve();
+            std::vector<sliding_puzzle::move> solution;
+            Assert::IsTrue(solver.get_solution(solution));
+            Assert::AreEqual(81, (int)solution.size());
+        }
+    }
+};
+
+TEST_CLASS(test_node_arena)
+{
+public:
+
+    TEST_METHOD(test_node_arena_growth)
+    {
+        node_arena<uint64_t, 4> values;
+        Assert::AreEqual(0, (int)values.capacity());
+        Assert::AreEqual(0, (int)values.bytes());
+
+        std::vector<uint64_t*> ptrs;
+        for (uint32_t i = 0; i < 1000; i++) {
+            const uint32_t idx = values.allocate();
+            Assert::AreEqual((int)i, (int)idx);
+            values[idx] = i*31;
+            ptrs.push_back(&values[idx]);
+        }
+        //  chunks of 16, 16, 32, ... 512
+        Assert::AreEqual(1000, (int)values.size());
+        Assert::AreEqual(1024, (int)values.capacity());
+        Assert::IsTrue(values.bytes() >= 1024*sizeof(uint64_t));
+        Assert::AreEqual(1000.0/1024, values.occupancy(), 1e-9);
+        for (uint32_t i = 0; i < 1000; i++) {
+            Assert::AreEqual((int)(i*31), (int)values[i]);
+            Assert::IsTrue(ptrs[i] == &values[i]);
+        }
+
+        const uint64_t bytes = values.bytes();
+        values.reset();
+        Assert::AreEqual(0, (int)values.size());
+        Assert::AreEqual(1024, (int)values.capacity());
+        Assert::IsTrue(bytes == values.bytes());
+        //  the memory is reused, the elements are constructed anew
+        Assert::AreEqual(0, (int)values.allocate());
+        Assert::IsTrue(ptrs[0] == &values[0]);
+        Assert::AreEqual(0, (int)values[0]);
+
+        values.clear();
+        Assert::AreEqual(0, (int)values.size());
+        Assert::AreEqual(0, (int)values.capacity());
+        Assert::AreEqual(0, (int)values.bytes());
+    }
+
+    TEST_METHOD(test_node_arena_huge_pages)
+    {
+        const huge_pages mode = page_memory::get_huge_pages();
+        for (auto m : { huge_pages::none, huge_pages::advise, huge_pages::reserved }) {
+            page_memory::set_huge_pages(m);
+            node_arena<uint64_t, 16> values;
+            //  up to the chunk of 4MB
+            for (uint32_t i = 0; i < (1u << 19); i++) {
+                values[values.allocate()] = i;
+            }
+            Assert::IsTrue(values.bytes() >= values.capacity()*sizeof(uint64_t));
+            for (uint32_t i = 0; i < (1u << 19); i += 4099) {
+                Assert::AreEqual((int)i, (int)values[i]);
+            }
+        }
+        page_memory::set_huge_pages(mode);
+    }
+};
+
+TEST_CLASS(test_closed_table)
+{
+public:
+
+    TEST_METHOD(test_closed_table0)
+    {
+        node_arena<uint64_t, 4> values;
+        closed_table table(16);
+
+        //  deliberately weak hash to get collisions on the table keys
+        auto hash = [](uint64_t v) { return (size_t)(v%37); };
+
+        for (uint64_t v = 0; v < 1000; v++) {
+            const uint64_t val = v*7919;
+            const uint32_t k = closed_table::key(hash(val));
+            uint32_t idx = table.find(k, [&](uint32_t i) { return values[i] == val; });
+            Assert::IsTrue(idx == closed_table::NONE);
+            idx = values.allocate();
+            values[idx] = val;
+            table.insert(k, idx);
+        }
+        Assert::AreEqual(1000, (int)table.size());
+        Assert::AreEqual(1000, (int)values.size());
+        Assert::IsTrue(table.load_factor() <= 0.7f);
+
+        for (uint64_t v = 0; v < 1000; v++) {
+            const uint64_t val = v*7919;
+            const uint32_t k = closed_table::key(hash(val));
+            uint32_t idx = table.find(k, [&](uint32_t i) { return values[i] == val; });
+            Assert::AreEqual((int)v, (int)idx);
+        }
+
+        const uint64_t missing = 7918;
+        uint32_t idx = table.find(closed_table::key(hash(missing)),
+            [&](uint32_t i) { return values[i] == missing; });
+        Assert::IsTrue(idx == closed_table::NONE);
+
+        const auto& stats = table.get_stats();
+        Assert::AreEqual(2001, (int)stats.lookups);
+        Assert::IsTrue(stats.avg_probes() >= 1.0);
+        Assert::IsTrue(stats.max_probes >= 1);
+    }
+};
+
 TEST_CLASS(test_trace_bitmap)
 {
 public:
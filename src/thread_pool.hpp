@@ -0,0 +1,135 @@
+#ifndef __THREAD_POOL__
+#define __THREAD_POOL__
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+//  Work stealing thread pool for independent tasks (e.g. the searches of different puzzles).
+//
+//  Every thread has its own task deque: the tasks submitted from outside are dealt to
+//  the deques in turn, the ones submitted by a task go to its thread's deque.
+//  A thread takes the most recently added task of its own deque, and when that is empty,
+//  steals the oldest one of another thread, so the long tasks don't hold up the rest.
+class thread_pool {
+public:
+    typedef std::function<void()> task;
+
+    //  num_threads = 0 uses all the hardware threads
+    explicit thread_pool(int num_threads = 0) : _next(0), _queued(0), _unfinished(0), _stop(false) {
+        if (num_threads <= 0) num_threads = std::max(1, (int)std::thread::hardware_concurrency());
+        for (int i = 0; i < num_threads; i++) _queues.emplace_back(new task_queue);
+        for (int i = 0; i < num_threads; i++) _threads.emplace_back([this, i] { run(i); });
+    }
+
+    //  runs the tasks left, then stops the threads
+    ~thread_pool() {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _work.notify_all();
+        for (auto& t : _threads) t.join();
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator =(const thread_pool&) = delete;
+
+    void submit(task t) {
+        const current_worker& cw = current();
+        const size_t idx = (cw.pool == this) ? (size_t)cw.index : _next++ % _queues.size();
+        {
+            //  counted along with queuing, so that a queued task is always counted
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::lock_guard<std::mutex> qlock(_queues[idx]->mutex);
+            _queues[idx]->tasks.push_back(std::move(t));
+            _queued++;
+            _unfinished++;
+        }
+        _work.notify_one();
+    }
+
+    //  blocks until all the tasks submitted are done
+    void wait() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done.wait(lock, [this] { return _unfinished == 0; });
+    }
+
+    int num_threads() const { return (int)_threads.size(); }
+
+private:
+    struct task_queue {
+        std::mutex          mutex;
+        std::deque<task>    tasks;
+    };
+
+    struct current_worker {
+        const thread_pool*  pool;   //  pool of the current thread, if it's a worker
+        int                 index;  //  its index in the pool
+    };
+
+    std::vector<std::unique_ptr<task_queue>>    _queues;        //  task deques, per thread
+    std::vector<std::thread>                    _threads;
+    std::atomic<size_t>                         _next;          //  deque for the next outside task
+    std::mutex                                  _mutex;         //  guards the counters below
+    std::condition_variable                     _work;          //  signalled when a task is queued
+    std::condition_variable                     _done;          //  signalled when all the tasks are done
+    size_t                                      _queued;        //  tasks waiting in the deques
+    size_t                                      _unfinished;    //  tasks submitted, not done yet
+    bool                                        _stop;
+
+    static current_worker& current() {
+        static thread_local current_worker cw = { nullptr, -1 };
+        return cw;
+    }
+
+    //  the own newest task, or the oldest one of another thread
+    bool take(int idx, task& res) {
+        const int n = (int)_queues.size();
+        for (int i = 0; i < n; i++) {
+            task_queue& q = *_queues[(idx + i) % n];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.tasks.empty()) continue;
+            if (i == 0) {
+                res = std::move(q.tasks.back());
+                q.tasks.pop_back();
+            } else {
+                res = std::move(q.tasks.front());
+                q.tasks.pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void run(int idx) {
+        current() = { this, idx };
+        task t;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _work.wait(lock, [this] { return _queued > 0 || _stop; });
+                if (_queued == 0) return;
+            }
+            if (!take(idx, t)) continue;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _queued--;
+            }
+            t();
+            t = nullptr;
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (--_unfinished == 0) _done.notify_all();
+        }
+    }
+};
+
+#endif // __THREAD_POOL__
@@ -0,0 +1,84 @@
+//  Generates the additive disjoint pattern databases for npuzzle, 
+//  to be memory-mapped by npuzzle_pdb::load()
+
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <chrono>
+
+#include "../npuzzle_pdb.hpp"
+
+typedef std::vector<std::vector<int>> partition_t;
+
+//  well known partitions (the target has the blank at the bottom right)
+static bool preset_partition(int n, int m, const std::string& name, partition_t& res) {
+    if (n == 3 && m == 3 && name == "4-4") {
+        res = { { 1, 2, 3, 4 }, { 5, 6, 7, 8 } };
+    } else if (n == 4 && m == 4 && name == "6-6-3") {
+        res = { { 1, 5, 6, 9, 10, 13 }, { 7, 8, 11, 12, 14, 15 }, { 2, 3, 4 } };
+    } else if (n == 4 && m == 4 && name == "7-8") {
+        res = { { 3, 4, 7, 8, 11, 12, 15 }, { 1, 2, 5, 6, 9, 10, 13, 14 } };
+    } else if (n == 5 && m == 5 && name == "6-6-6-6") {
+        res = { { 13, 18, 19, 20, 23, 24 }, { 11, 12, 16, 17, 21, 22 },
+            { 4, 5, 9, 10, 14, 15 }, { 1, 2, 3, 6, 7, 8 } };
+    } else {
+        return false;
+    }
+    return true;
+}
+
+//  explicit partition: tiles separated by commas, patterns by slashes, e.g. "1,2,3/4,5,6"
+static partition_t parse_partition(const std::string& str) {
+    partition_t res(1);
+    std::istringstream is(str);
+    int tile;
+    while (is >> tile) {
+        res.back().push_back(tile);
+        const char sep = (char)is.get();
+        if (sep == '/') res.push_back({});
+    }
+    return res;
+}
+
+template <int N, int M>
+int generate(const partition_t& partition, const std::string& path) {
+    using namespace std::chrono;
+    auto start = system_clock::now();
+
+    npuzzle_pdb<N, M> pdb;
+    if (!pdb.generate(partition)) {
+        std::cerr << "Invalid partition\n";
+        return 1;
+    }
+    if (!pdb.save(path)) {
+        std::cerr << "Could not write file: '" << path << "'\n";
+        return 1;
+    }
+    std::cout << "Pattern databases: " << partition.size() << " patterns, " << pdb.bytes() << 
+        " bytes\nElapsed time: " << duration_cast<seconds>(system_clock::now() - start).count() << 
+        " seconds\n";
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        std::cout << "Usage: " << argv[0] << " <N>x<M> <partition> <output file>\n"
+            "    partition is either a preset (4-4 for 3x3, 6-6-3 or 7-8 for 4x4, 6-6-6-6 for 5x5)\n"
+            "    or the pattern tiles, e.g. 1,2,3,4/5,6,7,8\n";
+        return 1;
+    }
+
+    int n = 0, m = 0;
+    char x = 0;
+    std::istringstream(argv[1]) >> n >> x >> m;
+    partition_t partition;
+    if (!preset_partition(n, m, argv[2], partition)) partition = parse_partition(argv[2]);
+
+    const std::string path(argv[3]);
+    if (n == 3 && m == 3) return generate<3, 3>(partition, path);
+    if (n == 4 && m == 4) return generate<4, 4>(partition, path);
+    if (n == 5 && m == 5) return generate<5, 5>(partition, path);
+    std::cerr << "Unsupported puzzle size: '" << argv[1] << "'\n";
+    return 1;
+}
@@ -0,0 +1,157 @@
+//  Solves many sliding puzzles concurrently, one A* search per puzzle,
+//  writing the results as JSON lines in the order of completion
+
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "../cmd_param.hpp"
+#include "../solve_service.hpp"
+#include "../thread_pool.hpp"
+
+static bool is_directory(const std::string& path) {
+#ifdef _WIN32
+    const DWORD attr = GetFileAttributesA(path.c_str());
+    return attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+//  the puzzle (.txt) files of the directory, sorted by name
+static std::vector<std::string> list_files(const std::string& dir) {
+    std::vector<std::string> res;
+#ifdef _WIN32
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA((dir + "\\*.txt").c_str(), &fd);
+    if (h != INVALID_HANDLE_VALUE) {
+        do {
+            if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) res.push_back(dir + "\\" + fd.cFileName);
+        } while (FindNextFileA(h, &fd));
+        FindClose(h);
+    }
+#else
+    DIR* d = opendir(dir.c_str());
+    if (d) {
+        while (dirent* e = readdir(d)) {
+            const std::string name = e->d_name;
+            if (name.size() < 4 || name.compare(name.size() - 4, 4, ".txt") != 0) continue;
+            const std::string path = dir + "/" + name;
+            struct stat st;
+            if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) res.push_back(path);
+        }
+        closedir(d);
+    }
+#endif
+    std::sort(res.begin(), res.end());
+    return res;
+}
+
+//  manifest: a puzzle file path per line, relative to the manifest's directory
+static std::vector<std::string> read_manifest(const std::string& path) {
+    std::vector<std::string> res;
+    std::ifstream fs(path);
+    const size_t sep = path.find_last_of("/\\");
+    const std::string dir = (sep == std::string::npos) ? std::string() : path.substr(0, sep + 1);
+    std::string line;
+    while (std::getline(fs, line)) {
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (line.empty() || line[0] == '#') continue;
+        const bool absolute = line[0] == '/' || line[0] == '\\' || (line.size() > 1 && line[1] == ':');
+        res.push_back(absolute ? line : dir + line);
+    }
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0] << " <puzzle directory|manifest file> [--threads=THREADS] "
+            "[--heuristic=admissible|weighted] [--weight=WEIGHT] [--time_limit=SECONDS] "
+            "[--max_memory=MEGABYTES] [--pdb_dir=DIR] [--pdb_size=MAX_ENTRIES] [--output=JSONL_FILE]\n"
+            "    all the .txt files of the directory are solved; the manifest lists the puzzle files,\n"
+            "    a line each (relative to the manifest's directory);\n"
+            "    the time and memory limits are per puzzle\n";
+        return 1;
+    }
+
+    const std::string input(argv[1]);
+    const std::vector<std::string> paths = is_directory(input) ? list_files(input) : read_manifest(input);
+
+    cmd_param param(argc, argv);
+    solve_options opt;
+    int num_threads = 0;
+    std::string output;
+    param.get("threads", num_threads);
+    param.get("heuristic", opt.heuristic);
+    param.get("weight", opt.weight);
+    param.get("time_limit", opt.time_limit);
+    param.get("max_memory", opt.max_memory);
+    const bool has_pdb_size = param.get("pdb_size", opt.pdb_size);
+    if (param.get("pdb_dir", opt.pdb_dir) && !has_pdb_size) opt.pdb_size = sliding_puzzle::DEFAULT_PDB_ENTRIES;
+    param.get("output", output);
+
+    std::ofstream out_fs;
+    if (!output.empty()) {
+        out_fs.open(output);
+        if (!out_fs.is_open()) {
+            std::cerr << "Could not create file: '" << output << "'\n";
+            return 1;
+        }
+    }
+    std::ostream& out = output.empty() ? std::cout : out_fs;
+
+    //  the identical puzzles share the board and the solution
+    std::vector<std::string> texts(paths.size());
+    std::vector<bool> opened(paths.size(), false);
+    for (size_t i = 0; i < paths.size(); i++) {
+        std::ifstream fs(paths[i]);
+        if (!fs.is_open()) continue;
+        std::stringstream ss;
+        ss << fs.rdbuf();
+        texts[i] = ss.str();
+        opened[i] = true;
+    }
+
+    using namespace std::chrono;
+    const auto start = steady_clock::now();
+    solve_service service;
+    std::mutex out_mutex;
+    {
+        thread_pool pool(num_threads);
+        for (size_t i = 0; i < paths.size(); i++) {
+            pool.submit([&, i] {
+                solve_result res;
+                if (opened[i]) {
+                    res = service.solve(texts[i], opt);
+                } else {
+                    res.status = "error";
+                    res.error = "could not open the file";
+                }
+                const std::string line = result_json("\"file\":" + json_str(paths[i]), res) + "\n";
+                std::lock_guard<std::mutex> lock(out_mutex);
+                out << line << std::flush;
+            });
+        }
+    }
+
+    const auto stats = service.get_stats();
+    std::cerr << "Puzzles: " << paths.size() << " (" << stats.boards << " distinct), elapsed time: " <<
+        duration<double>(steady_clock::now() - start).count() << " seconds\n";
+    return 0;
+}
@@ -0,0 +1,85 @@
+//  Enumerates all the positions of a sliding puzzle reachable from its source,
+//  optionally saving the distance to target table, to be loaded by state_space::load()
+
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <chrono>
+
+#include "../cmd_param.hpp"
+#include "../state_space.hpp"
+
+template <typename TPos>
+int enumerate(const sliding_puzzle& sp, int num_threads, const std::string& table_path) {
+    using namespace std::chrono;
+    auto start = system_clock::now();
+
+    state_space ss;
+    if (!ss.enumerate(sp, sp.get_source<TPos>(), num_threads)) {
+        std::cerr << "The puzzle positions can't be ranked\n";
+        return 1;
+    }
+
+    std::cout << "Reachable positions: " << ss.num_states() << " (of " << ss.num_ranks() << " ranks)\n" <<
+        "Largest distance from the source: " << ss.depth() << "\nPositions per distance:";
+    for (auto n : ss.histogram()) std::cout << " " << n;
+    std::cout << "\nTarget positions: " << ss.num_targets() << "\n";
+    if (ss.num_targets() > 0) {
+        const uint16_t dist = ss.distance_to_target(ss.index(sp.rank(sp.get_source<TPos>())));
+        std::cout << "Optimal solution: " << dist << " moves\n" <<
+            "Largest distance to the target: " << ss.max_distance_to_target() << "\n";
+    }
+
+    if (!table_path.empty() && !ss.save(table_path)) {
+        std::cerr << "Could not write file: '" << table_path << "'\n";
+        return 1;
+    }
+    std::cout << "Elapsed time: " << duration_cast<seconds>(system_clock::now() - start).count() <<
+        " seconds\n";
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0] << " <puzzle layout file> [--threads=THREADS] "
+            "[--table=OUTPUT_FILE] [--max_ranks=MAX_RANKS]\n"
+            "    the visited positions take a bit per rank, so the puzzles with more than\n"
+            "    MAX_RANKS ranks (2^36 by default) are refused\n";
+        return 1;
+    }
+
+    const std::string path(argv[1]);
+    std::ifstream fs(path);
+    if (!fs.is_open()) {
+        std::cerr << "Could not open file: '" << path << "'\n";
+        return 1;
+    }
+    sliding_puzzle sp;
+    std::string error;
+    if (!sp.parse(fs, error)) {
+        std::cerr << "Could not parse the puzzle '" << path << "': " << error << "\n";
+        return 1;
+    }
+    fs.close();
+
+    cmd_param param(argc, argv);
+    int num_threads = 0;
+    std::string table_path;
+    uint64_t max_ranks = 1ull << 36;
+    param.get("threads", num_threads);
+    param.get("table", table_path);
+    param.get("max_ranks", max_ranks);
+
+    if (sp.num_ranks() == 0 || sp.num_ranks() > max_ranks) {
+        std::cerr << "Too many positions to enumerate\n";
+        return 1;
+    }
+
+    const int npieces = sp.num_pieces();
+    if (npieces <= 8) return enumerate<sliding_puzzle::fixed_position<8>>(sp, num_threads, table_path);
+    if (npieces <= 16) return enumerate<sliding_puzzle::fixed_position<16>>(sp, num_threads, table_path);
+    if (npieces <= 32) return enumerate<sliding_puzzle::fixed_position<32>>(sp, num_threads, table_path);
+    return enumerate<sliding_puzzle::position>(sp, num_threads, table_path);
+}
@@ -0,0 +1,239 @@
+//  Solver server: answers the solve requests of the many clients concurrently (from a thread pool),
+//  keeping the parsed boards, their heuristic tables and pattern databases, and the solutions
+//  warm between the requests (solve_service), so a repeated request is answered from memory.
+//
+//  Line protocol, over a Unix domain socket (--socket=PATH) or stdin/stdout:
+//      solve [--id=ID] [--heuristic=admissible|weighted] [--weight=WEIGHT] [--time_limit=SECONDS]
+//            [--max_memory=MEGABYTES] [--pdb_size=MAX_ENTRIES]
+//      <the puzzle file lines>
+//      end
+//  is answered with a JSON line {"id":"ID","status":...} once solved (the requests of a connection
+//  may be answered out of order); the options default to the server's command line ones.
+//      stats   - answered with the cache statistics
+//      quit    - closes the connection (on stdin, stops the server once the requests are answered)
+
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <cstring>
+#include <cerrno>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#include "../cmd_param.hpp"
+#include "../solve_service.hpp"
+#include "../thread_pool.hpp"
+
+//  a client: lines read from the input descriptor, written to the output one
+class connection {
+public:
+    connection(int in, int out, bool is_socket) : _in(in), _out(out), _socket(is_socket), _pos(0), _len(0) {}
+
+    connection(const connection&) = delete;
+    connection& operator =(const connection&) = delete;
+
+    ~connection() {
+#ifndef _WIN32
+        if (_socket) close(_in);
+#endif
+    }
+
+    //  the next line, without the line end; false at the end of the input
+    bool read_line(std::string& line) {
+        line.clear();
+        while (true) {
+            if (_pos == _len) {
+#ifdef _WIN32
+                const int n = _read(_in, _buf, sizeof(_buf));
+#else
+                const int n = (int)read(_in, _buf, sizeof(_buf));
+#endif
+                if (n <= 0) return !line.empty();
+                _pos = 0;
+                _len = n;
+            }
+            const char c = _buf[_pos++];
+            if (c == '\n') break;
+            if (c != '\r') line += c;
+        }
+        return true;
+    }
+
+    //  whole lines, from any thread
+    bool write_line(const std::string& line) {
+        const std::string data = line + "\n";
+        std::lock_guard<std::mutex> lock(_write_mutex);
+        size_t done = 0;
+        while (done < data.size()) {
+#ifdef _WIN32
+            const int n = _write(_out, data.data() + done, (unsigned)(data.size() - done));
+#else
+            const int n = (int)write(_out, data.data() + done, data.size() - done);
+#endif
+            if (n <= 0) return false;
+            done += n;
+        }
+        return true;
+    }
+
+private:
+    int         _in;            //  input descriptor
+    int         _out;           //  output descriptor
+    bool        _socket;        //  whether the descriptors are the socket, closed at the end
+    char        _buf[4096];     //  input buffer
+    int         _pos;           //  next character in the buffer
+    int         _len;           //  characters in the buffer
+    std::mutex  _write_mutex;
+};
+
+static std::string stats_json(const solve_service::stats& stats) {
+    std::ostringstream ss;
+    ss << "{\"requests\":" << stats.requests << ",\"board_hits\":" << stats.board_hits <<
+        ",\"solution_hits\":" << stats.solution_hits << ",\"boards\":" << stats.boards << "}";
+    return ss.str();
+}
+
+//  the request options, over the defaults
+static solve_options request_options(const std::vector<std::string>& tokens, const solve_options& defaults,
+    std::string& id) {
+    std::vector<char*> args;
+    std::vector<std::string> words(tokens);
+    for (auto& w : words) args.push_back(&w[0]);
+    cmd_param param((int)args.size(), args.data());
+    solve_options res = defaults;
+    param.get("id", id);
+    param.get("heuristic", res.heuristic);
+    param.get("weight", res.weight);
+    param.get("time_limit", res.time_limit);
+    param.get("max_memory", res.max_memory);
+    param.get("pdb_size", res.pdb_size);
+    return res;
+}
+
+//  reads the requests of the connection, the solve ones are answered by the pool
+static void serve(std::shared_ptr<connection> conn, solve_service& service, thread_pool& pool,
+    const solve_options& defaults) {
+    std::string line;
+    uint64_t nrequests = 0;
+    while (conn->read_line(line)) {
+        std::istringstream ss(line);
+        std::vector<std::string> tokens;
+        std::string token;
+        while (ss >> token) tokens.push_back(token);
+        if (tokens.empty()) continue;
+
+        const std::string& cmd = tokens[0];
+        if (cmd == "quit") break;
+        if (cmd == "stats") {
+            conn->write_line(stats_json(service.get_stats()));
+            continue;
+        }
+        if (cmd != "solve") {
+            conn->write_line("{\"status\":\"error\",\"error\":" + json_str("unknown command: " + cmd) + "}");
+            continue;
+        }
+
+        std::string id = std::to_string(nrequests++);
+        const solve_options opt = request_options(tokens, defaults, id);
+        std::string text;
+        bool complete = false;
+        while (conn->read_line(line)) {
+            if (line == "end") {
+                complete = true;
+                break;
+            }
+            text += line + "\n";
+        }
+        if (!complete) break;
+
+        pool.submit([conn, &service, text, opt, id] {
+            const solve_result res = service.solve(text, opt);
+            conn->write_line(result_json("\"id\":" + json_str(id), res));
+        });
+    }
+}
+
+int main(int argc, char *argv[]) {
+    cmd_param param(argc, argv);
+    bool help = false;
+    if (param.get("help", help)) {
+        std::cout << "Usage: " << argv[0] << " [--socket=PATH] [--threads=THREADS] [--max_boards=N] "
+            "[--heuristic=admissible|weighted] [--weight=WEIGHT] [--time_limit=SECONDS] "
+            "[--max_memory=MEGABYTES] [--pdb_dir=DIR] [--pdb_size=MAX_ENTRIES]\n"
+            "    serves the requests on the Unix domain socket, or on stdin/stdout;\n"
+            "    the options are the defaults of the requests\n";
+        return 1;
+    }
+
+    std::string socket_path;
+    int num_threads = 0;
+    size_t max_boards = 0;
+    solve_options defaults;
+    param.get("socket", socket_path);
+    param.get("threads", num_threads);
+    param.get("max_boards", max_boards);
+    param.get("heuristic", defaults.heuristic);
+    param.get("weight", defaults.weight);
+    param.get("time_limit", defaults.time_limit);
+    param.get("max_memory", defaults.max_memory);
+    const bool has_pdb_size = param.get("pdb_size", defaults.pdb_size);
+    if (param.get("pdb_dir", defaults.pdb_dir) && !has_pdb_size) defaults.pdb_size = sliding_puzzle::DEFAULT_PDB_ENTRIES;
+
+    solve_service service(max_boards);
+    thread_pool pool(num_threads);
+
+    if (socket_path.empty()) {
+        serve(std::make_shared<connection>(0, 1, false), service, pool, defaults);
+        pool.wait();
+        return 0;
+    }
+
+#ifdef _WIN32
+    std::cerr << "Unix domain sockets are not supported, serving stdin/stdout without --socket\n";
+    return 1;
+#else
+    //  a client gone before its answers is not an error
+    signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Socket path too long: '" << socket_path << "'\n";
+        return 1;
+    }
+    strcpy(addr.sun_path, socket_path.c_str());
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path.c_str());
+    if (fd < 0 || bind(fd, (const sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+        std::cerr << "Could not listen on socket: '" << socket_path << "' (" << strerror(errno) << ")\n";
+        return 1;
+    }
+    std::cerr << "Listening on '" << socket_path << "', " << pool.num_threads() << " threads\n";
+
+    //  a reader thread per client, the searches on the pool
+    while (true) {
+        const int client = accept(fd, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        auto conn = std::make_shared<connection>(client, client, true);
+        std::thread([conn, &service, &pool, &defaults] { serve(conn, service, pool, defaults); }).detach();
+    }
+    close(fd);
+    unlink(socket_path.c_str());
+    return 0;
+#endif
+}
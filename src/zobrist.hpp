@@ -0,0 +1,49 @@
+#ifndef __ZOBRIST__
+#define __ZOBRIST__
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <type_traits>
+#include <utility>
+
+//  Zobrist hashing helpers.
+//
+//  A position can carry its own incrementally updated 64-bit hash in a "zobrist" member
+//  (the problem keeps it up to date in apply_move/unapply_move); position_hash() then
+//  uses it directly instead of calling the position's hash operator.
+
+//  fills the keys table with deterministic pseudo-random values (splitmix64)
+inline void zobrist_fill(std::vector<uint64_t>& keys, size_t n, uint64_t seed = 0x2545F4914F6CDD1Dull) {
+    keys.resize(n);
+    uint64_t s = seed;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t z = (s += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27))*0x94D049BB133111EBull;
+        keys[i] = z ^ (z >> 31);
+    }
+}
+
+template <typename TPos, typename = void>
+struct has_zobrist : std::false_type {};
+
+template <typename TPos>
+struct has_zobrist<TPos, decltype((void)std::declval<const TPos&>().zobrist)> : std::true_type {};
+
+template <typename TPos>
+inline size_t position_hash(const TPos& pos, std::true_type) {
+    return (size_t)pos.zobrist;
+}
+
+template <typename TPos>
+inline size_t position_hash(const TPos& pos, std::false_type) {
+    return pos();
+}
+
+template <typename TPos>
+inline size_t position_hash(const TPos& pos) {
+    return position_hash(pos, has_zobrist<TPos>());
+}
+
+#endif // __ZOBRIST__